@@ -2,7 +2,9 @@
 param (
     [string]$ProjectPath,
     [switch]$ParseMeta,
-    [switch]$CheckShader
+    [switch]$CheckShader,
+    [switch]$ScalarMath,
+    [switch]$AVX2
 )
 
 # $project_path = "C:/Users/psmmicha0040/Documents/Project/Prototypes/GameProject";
@@ -27,6 +29,16 @@ $d_base_path,
 '/D"DEBUG=1"',
 '/D"OS=WIN"'
 ;
+
+# CoreMath SIMD backend: SSE2 by default on x64,
+# -AVX2 enables the 256 bit kernels, -ScalarMath forces the scalar fallback
+if($AVX2) {
+    $flags += '/arch:AVX2';
+}
+if($ScalarMath) {
+    $flags += '/D"CORE_MATH_SCALAR=1"';
+}
+
 $source = 
 'src/EnginePlatform.cpp',
 'src/EngineCore.cpp',
@@ -39,6 +51,8 @@ $source =
 'src/core/GameLoader.cpp',
 'src/core/Math.cpp',
 'src/core/Geometry.cpp',
+'src/core/DSA.cpp',
+'src/core/Jobs.cpp',
 'src/core/DebugDraw.cpp',
 'src/core/Physics.cpp',
 'src/platform/Graphics_d3d.cpp',
@@ -0,0 +1,47 @@
+# Build Engine Bench
+# Run ./bin/EngineBench.exe [filter], it exits non zero when an accuracy check fails.
+# Build once with and once without -ScalarMath to compare the CoreMath backends.
+param (
+    [switch]$ScalarMath,
+    [switch]$AVX2
+)
+
+echo "`nCompiling Engine Bench..."
+echo "Accuracy checks and microbenchmarks for the engine core`n"
+
+$flags = '/std:c++17',
+'/I./include/', 
+'/I./include/utils/freetype/', 
+'/I./src',
+'/O2',
+'/Zi',
+'/EHsc', 
+'/DOS=WIN',
+'/Fo"./bin/"',
+'/Fe"./bin/"'
+
+if($AVX2) {
+    $flags += '/arch:AVX2';
+}
+if($ScalarMath) {
+    $flags += '/D"CORE_MATH_SCALAR=1"';
+}
+
+$source = 
+'src/EngineBench.cpp',
+'src/core/Math.cpp',
+'src/core/Geometry.cpp',
+'src/core/DSA.cpp',
+'src/core/Jobs.cpp',
+'src/core/Physics.cpp',
+'src/core/SceneGraph.cpp',
+'src/core/GameObject.cpp',
+'src/core/GameResource.cpp',
+'src/utils/Debug.cpp',
+'src/utils/RUID.cpp',
+'src/platform/Graphics_null.cpp',
+'src/platform/FontLoader_null.cpp'
+
+CL $flags $source 
+
+echo "`nDone`n"
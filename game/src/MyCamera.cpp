@@ -16,22 +16,22 @@ void MyCamera::Start(Node2D *self) {
 void MyCamera::Update(Node2D *self) {
     MyCamera *myCam = (MyCamera *) self;
     if(CoreInput::IsKeyPressed(CoreInput::KeyCode::KEY_W)) {
-        myCam->parent.transform.pos.y += myCam->velocity;
+        GameObject::Translate(self, Vector2{0.0f, myCam->velocity});
         myCam->count++;
         // Debug::Logger("up", myCam->parent.transform.pos.y);
     }
     else if(CoreInput::IsKeyPressed(CoreInput::KeyCode::KEY_S)) {
-        myCam->parent.transform.pos.y -= myCam->velocity;
+        GameObject::Translate(self, Vector2{0.0f, -myCam->velocity});
         myCam->count++;
         // Debug::Logger("down", myCam->parent.transform.pos.y);
     }
     else if(CoreInput::IsKeyPressed(CoreInput::KeyCode::KEY_A)) {
-        myCam->parent.transform.pos.x -= myCam->velocity;
+        GameObject::Translate(self, Vector2{-myCam->velocity, 0.0f});
         myCam->count++;
         // Debug::Logger("left", myCam->parent.transform.pos.x);
     }
     else if(CoreInput::IsKeyPressed(CoreInput::KeyCode::KEY_D)) {
-        myCam->parent.transform.pos.x += myCam->velocity;
+        GameObject::Translate(self, Vector2{myCam->velocity, 0.0f});
         myCam->count++;
         // Debug::Logger("right", myCam->parent.transform.pos.x);
     }
@@ -104,6 +104,7 @@
 
 #include <core/CoreGlobals.h>
 #include <core/GameObject.h>
+#include <core/GameObject_impl.h>
 #include <core/GameResource.h>
 #include <core/Math.h>
 #include <core/Math_impl.h>
@@ -117,6 +118,8 @@
 namespace Engine {
     bool RegisterTypeFactory(std::string typeName, FactoryFunctionType factory);
     void SetGameFPS(uint32_t fps);
+    // Sets the filter of a Sprite or Empty, and of its collider when it has one
+    void SetCollisionFilter(Node2D *node, uint32_t categories, uint32_t mask);
 };
 
 
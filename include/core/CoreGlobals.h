@@ -2,6 +2,7 @@
 #define CORE_GLOBALS_H
 
 #include <core/Physics.h>
+#include <core/Jobs.h>
 #include <core/GameObject.h>
 #include <core/SceneGraph.h>
 #include <core/DebugDraw.h>
@@ -20,7 +21,7 @@
 typedef Node2D* (*FactoryFunctionType)(Node2D*);
 
 namespace CoreGlobals {
-    extern std::unordered_map<std::string, GameObject::Node2D*> nodes;
+    extern GameObject::NodeRegistry nodes;
     extern std::unordered_map<std::string, std::vector<GameObject::Node2D*>> _nodes;
     extern std::unordered_map<std::string, GameResource::Resource*> resources;
     extern std::unordered_map<std::string, GameResource::Material*> materials;
@@ -42,6 +43,7 @@ namespace CoreGlobals {
 
     extern SceneGraph::Scene* activeScene;
     extern CorePhysics::World* physicsWorld;
+    extern CoreJobs::JobSystem* jobSystem;
 
     extern std::string PROJECT_BASE_PATH;
     const std::string RESOURCE_BASE_PATH = "resources";
@@ -2,18 +2,100 @@
 #define DSA_H
 
 #include <core/Math_impl.h>
+#include <core/Geometry.h>
 #include <vector>
 
 /*
  * Header:  DSA.h
  * Impl:    DSA.cpp
- * Purpose: 
+ * Purpose: Engine data structures
  * Author:  Michael Herman
  * */
 
 
 namespace CoreDSA {
 
+    /*
+     * Dynamic AABB tree
+     * Binary tree of fattened leaf bounds, nodes live in a pool and refer
+     * to each other by index so the tree can be copied and grown freely.
+     * Leaves only get reinserted when their tight bounds leave the fat ones,
+     * or when the fat ones grew far too large for a leaf that slowed down,
+     * so static and slow objects cost nothing per step.
+     * */
+
+    const int32_t NULL_NODE = -1;
+    const int32_t TREE_STACK_SIZE = 256; // traversal entries kept on the stack, deeper ones spill to the heap
+
+    struct TreeNode {
+        CoreGeometry::BoundingRect aabb; // fat bounds for leaves
+        int32_t parent;                  // next free node while on the free list
+        int32_t child1;
+        int32_t child2;
+        int32_t height;                  // 0 for leaves, -1 for free nodes
+        uint32_t userData;
+        bool moved;
+    };
+
+    struct ProxyPair {
+        uint32_t a; // userData, a < b
+        uint32_t b;
+    };
+
+    struct DynamicTree {
+        std::vector<TreeNode> nodes;
+        int32_t root = NULL_NODE;
+        int32_t freeList = NULL_NODE;
+        float fatMargin = 4.0f;           // added on every side of a leaf
+        float displacementMultiplier = 2.0f; // leaves are stretched along their motion
+        float refitRatio = 2.0f;          // fat bounds this much larger than a fresh fit are refitted
+        std::vector<int32_t> moveBuffer;  // proxies reinserted since the last pair query
+    };
+
+    // return false to stop the query
+    typedef bool (*TreeQueryCallback)(int32_t proxy, void *context);
+    // return the new max distance to clip the ray, 0 to stop
+    typedef float (*TreeRaycastCallback)(
+        int32_t proxy,
+        const Vector2 &origin,
+        const Vector2 &direction,
+        float maxDistance,
+        void *context
+        );
+
+    int32_t CreateProxy(DynamicTree *tree, const CoreGeometry::BoundingRect &aabb, uint32_t userData);
+    void DestroyProxy(DynamicTree *tree, int32_t proxy);
+    // returns true when the proxy had to be reinserted
+    bool MoveProxy(
+        DynamicTree *tree,
+        int32_t proxy,
+        const CoreGeometry::BoundingRect &aabb,
+        const Vector2 &displacement
+        );
+    // Reports the proxy's pairs again on the next QueryPairs without moving it
+    void TouchProxy(DynamicTree *tree, int32_t proxy);
+    void ClearTree(DynamicTree *tree);
+
+    void Query(const DynamicTree &tree, const CoreGeometry::BoundingRect &aabb, TreeQueryCallback callback, void *context);
+    // direction must be normalized
+    void Raycast(
+        const DynamicTree &tree,
+        const Vector2 &origin,
+        const Vector2 &direction,
+        float maxDistance,
+        TreeRaycastCallback callback,
+        void *context
+        );
+    // Appends every pair of overlapping fat bounds that involves a moved proxy,
+    // each pair once, then clears the move buffer
+    void QueryPairs(DynamicTree *tree, std::vector<ProxyPair> &pairs);
+    // Read only part of QueryPairs for a slice of the move buffer,
+    // safe to run on several threads before ClearMoveBuffer
+    void QueryPairs(const DynamicTree &tree, const int32_t *proxies, uint32_t count, std::vector<ProxyPair> &pairs);
+    void ClearMoveBuffer(DynamicTree *tree);
+
+    int32_t GetHeight(const DynamicTree &tree);
+
 }
 
 #endif
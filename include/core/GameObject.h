@@ -21,6 +21,10 @@
 using namespace CoreMath;
 using namespace GameResource;
 
+namespace SceneGraph {
+    struct Scene;
+}
+
 
 namespace GameObject {
 
@@ -38,11 +42,42 @@ namespace GameObject {
         LINE = 6
     };
 
+    /*
+     * Node handles
+     * Primary identity of a node, a slot index and the generation the slot
+     * had when the node was registered. Slots are reused with a new
+     * generation, so a handle to a destroyed node resolves to nullptr.
+     * String ids only name nodes in level files.
+     * */
+    struct NodeHandle {
+        uint32_t index;
+        uint32_t generation; // 0 is never live
+    };
+
+    const NodeHandle INVALID_NODE = {0xFFFFFFFF, 0};
+
+    struct Node2D;
+
+    struct NodeSlot {
+        Node2D *node;
+        uint32_t generation;
+        uint32_t dense;      // position in NodeRegistry::nodes, next free slot while free
+    };
+
+    struct NodeRegistry {
+        std::vector<NodeSlot> slots;
+        uint32_t freeSlot = 0xFFFFFFFF;  // head of the free slot list
+        std::vector<Node2D*> nodes;      // every live node, packed
+        std::vector<uint32_t> denseSlots; // slot of nodes[i]
+    };
+
     struct Geometry2D {
         CoreGeometry::BoundingRect AABB;
         std::vector<Vector4> vertices;
+        Vector2 halfExtents; // vertices are a rect centred at the origin
         GraphicsResource mesh;
         bool showBoundingRect = false;
+        int32_t proxy = -1; // leaf in the scene spatial index, -1 when not indexed
     };
 
     struct Transform2D {
@@ -50,8 +85,20 @@ namespace GameObject {
         Vector4 worldPos;
         Vector2 scale;
         float rotation;
-        Matrix Local;
-        Matrix World;
+        Affine2D Local;
+        Affine2D World;
+
+        // last rotation seen by UpdatePass and its sin/cos,
+        // an unchanged rotation does not call SinCos again
+        float cachedRotation = 0.0f;
+        float sinRotation = 0.0f;
+        float cosRotation = 1.0f;
+
+        // set by the transform setters, UpdatePass only recomputes dirty
+        // nodes and the subtrees below them
+        bool dirty = true;
+        bool queued = false;       // in the dirty list of its scene
+        uint32_t updatedFrame = 0; // scene frame of the last recompute
     };
 
     /*
@@ -60,12 +107,16 @@ namespace GameObject {
 
     struct Node2D {
         Type type;
-        std::string id;
+        NodeHandle handle = INVALID_NODE;
+        std::string id; // level file id
         std::string name;
         std::string tag;
         std::vector<Node2D*> children;
-        Node2D* parent;
+        Node2D* parent = nullptr;
         int zIndex = 0;
+        uint8_t layer = 0; // drawn before zIndex is considered, higher layers on top
+        int32_t sceneIndex = -1; // position in the scene hierarchy, -1 outside of a scene
+        SceneGraph::Scene *scene = nullptr; // scene holding the node, set along with sceneIndex
         std::vector<MetaField> meta;
         struct {
             void (*Start)(Node2D*) = nullptr;
@@ -73,19 +124,23 @@ namespace GameObject {
             void (*Shutdown)(Node2D*) = nullptr;
             void (*Serialize)(Node2D*) = nullptr;
             void (*DeSerialize)(Node2D*) = nullptr;
+            // physics events of the last step, dispatched once per event after CorePhysics::Step
+            void (*OnContact)(Node2D*, const CorePhysics::ContactEvent&) = nullptr;
         } behavior;
     };
 
     struct Empty {
         Node2D attribute;
         Transform2D transform;
-        CorePhysics::Collider *collider = nullptr;
+        CorePhysics::ColliderHandle collider = CorePhysics::INVALID_COLLIDER;
+        CorePhysics::CollisionFilter collisionFilter;
     };
 
     struct Sprite {
         Node2D attribute;
         Transform2D transform;
-        CorePhysics::Collider *collider = nullptr;
+        CorePhysics::ColliderHandle collider = CorePhysics::INVALID_COLLIDER;
+        CorePhysics::CollisionFilter collisionFilter;
         Geometry2D geometry;
         GameResource::Material *material;
     };
@@ -5,6 +5,21 @@
 
 namespace GameObject {
     std::string GenerateGameObjectID(Type type);
+    // Moves the counter of the id's type past a loaded id so generated ids never collide
+    void ReserveGameObjectID(const std::string &id);
+
+    // Node handles, O(1) lookups that return nullptr for stale handles
+    NodeHandle RegisterNode(Node2D *node);
+    bool UnregisterNode(NodeHandle handle);
+    // Points the node's handle at node, for factories that copy a node into a new object
+    bool RebindNode(Node2D *node);
+    Node2D* GetNode(NodeHandle handle);
+    bool IsValidNode(NodeHandle handle);
+    // Every live node, packed, the order changes when nodes are unregistered
+    const std::vector<Node2D*>& GetAllNodes();
+    // Takes node with its subtree out of its scene, destroys their colliders
+    // and graphics resources, unregisters and deletes them
+    bool DestroyNode(Node2D *node);
 
     Node2D* CreateNode2D(std::string name);
     // std::vector<Node2D*> GetNodesByName(std::string name);
@@ -58,6 +73,14 @@ namespace GameObject {
         std::string id = ""
         );
 
+    // Transform setters, they mark the node so UpdatePass recomputes it.
+    // Writing transform fields directly skips that and is not picked up.
+    void SetPosition(Node2D *node, const Vector2 &pos);
+    void Translate(Node2D *node, const Vector2 &delta);
+    void SetScale(Node2D *node, const Vector2 &scale);
+    void SetRotation(Node2D *node, float degrees);
+    void MarkTransformDirty(Node2D *node);
+
 }
 
 #endif
@@ -34,6 +34,7 @@ namespace GameResource {
     struct Resource {
         std::string id;
         std::string name;
+        uint32_t sortId = 0; // small creation order id, packed into render sort keys
     };
 
     
@@ -4,6 +4,7 @@
 #include <core/Math_impl.h>
 #include <core/GameResource.h>
 #include <vector>
+#include <cstdint>
 
 /*
  * Header:  Geometry.h
@@ -12,15 +13,71 @@
  * Author:  Michael Herman
  * */
 
-// TODO: Improve this module from physics engine,
-// make mulitple intersection test, shapes inheritance etc
-
 
 using namespace CoreMath;
 
 namespace CoreGeometry {
+
+    /*
+     * Shapes
+     * Plain tagged union, no inheritance so that shapes can live by value
+     * in contiguous arrays and be dispatched with a table lookup.
+     * All shapes are in local space, Collide(..) takes their transforms.
+     * */
+
+    enum ShapeType {
+        SHAPE_CIRCLE = 0,
+        SHAPE_CAPSULE = 1,
+        SHAPE_BOX = 2,
+        SHAPE_POLYGON = 3,
+        SHAPE_TYPE_COUNT = 4
+    };
+
+    const uint32_t MAX_POLYGON_VERTICES = 8;
+
+    struct Circle {
+        Vector2 center;
+        float radius;
+    };
+
+    struct Capsule {
+        Vector2 p1;
+        Vector2 p2;
+        float radius;
+    };
+
+    struct OrientedBox {
+        Vector2 center;
+        Vector2 halfExtents;
+        float rotation; // degrees, relative to the shape transform
+    };
+
+    // Convex, counter clockwise. radius > 0 gives a rounded polygon
+    struct Polygon {
+        Vector2 vertices[MAX_POLYGON_VERTICES];
+        Vector2 normals[MAX_POLYGON_VERTICES];
+        uint32_t count;
+        float radius;
+    };
+
     struct Shape {
+        ShapeType type;
+        union {
+            Circle circle;
+            Capsule capsule;
+            OrientedBox box;
+            Polygon polygon;
+        };
+    };
 
+    // Result of a narrowphase test, normal points from shape A to shape B.
+    // Points are in world space, halfway between both surfaces,
+    // depths are the penetration at each point (positive when overlapping)
+    struct Manifold {
+        Vector2 normal;
+        Vector2 points[2];
+        float depths[2];
+        uint32_t pointCount;
     };
 
     struct BoundingRect {
@@ -40,18 +97,85 @@ namespace CoreGeometry {
     };
 
     BoundingRect CreateAABB(
-        std::vector<Vector4> vertices,
-        Matrix transform = CoreMath::IdentityMatrix()
+        const std::vector<Vector4> &vertices,
+        const Affine2D &transform = CoreMath::IdentityAffine2D()
+        );
+    void UpdateAABB(
+        BoundingRect *rect,
+        const std::vector<Vector4> &vertices,
+        const Affine2D &transform = CoreMath::IdentityAffine2D()
+        );
+
+    // Centred rectangles (sprites, texts, cameras), the world AABB is computed
+    // directly from the half extents: center = translation, extent = |M| * h
+    BoundingRect CreateAABB(
+        const Vector2 &halfExtents,
+        const Affine2D &transform = CoreMath::IdentityAffine2D()
         );
     void UpdateAABB(
         BoundingRect *rect,
-        std::vector<Vector4> vertices,
-        Matrix transform = CoreMath::IdentityMatrix()
+        const Vector2 &halfExtents,
+        const Affine2D &transform
+        );
+    void UpdateAABBs(
+        BoundingRect *rects,
+        const Vector2 *halfExtents,
+        const Affine2D *transforms,
+        uint32_t count
         );
 
     // bool Intersect(BoundingShape *b1, BoundingShape *b2);
     bool Intersect(BoundingRect *b1, BoundingRect *b2);
 
+    Shape CreateCircle(const Vector2 &center, float radius);
+    Shape CreateCapsule(const Vector2 &p1, const Vector2 &p2, float radius);
+    Shape CreateBox(
+        const Vector2 &halfExtents,
+        const Vector2 &center = Vector2{0.0f, 0.0f},
+        float rotation = 0.0f
+        );
+    // points must form a convex hull, winding is fixed up to counter clockwise
+    Shape CreatePolygon(const Vector2 *points, uint32_t count, float radius = 0.0f);
+
+    // World space AABB of a shape
+    BoundingRect ComputeAABB(const Shape &shape, const Affine2D &transform);
+
+    // Narrowphase, returns true and fills the manifold when the shapes touch.
+    // Transforms may translate, rotate and scale the vertices, radii are not scaled.
+    bool Collide(
+        const Shape &a, const Affine2D &transformA,
+        const Shape &b, const Affine2D &transformB,
+        Manifold *manifold
+        );
+
+    // Gap between the surfaces of two shapes whose cores do not overlap.
+    // The manifold gets one point halfway between the closest points, the
+    // normal from A to B and minus the gap as depth. Callers test Collide first,
+    // a core inside the other one has no meaningful gap.
+    float Distance(
+        const Shape &a, const Affine2D &transformA,
+        const Shape &b, const Affine2D &transformB,
+        Manifold *manifold
+        );
+
+    // Ray against a shape, direction must be normalized.
+    // Rays starting inside the shape report no hit.
+    bool Raycast(
+        const Shape &shape, const Affine2D &transform,
+        const Vector2 &origin, const Vector2 &direction, float maxDistance,
+        float *distance, Vector2 *normal
+        );
+
+    // Batch frustum culling, writes the index of every bound overlapping
+    // the camera rect into visibleIndices (room for count indices)
+    // in ascending order and returns how many were written
+    uint32_t CullAABBs(
+        const BoundingRect &camera,
+        const BoundingRect *bounds,
+        uint32_t count,
+        uint32_t *visibleIndices
+        );
+
 }
 
 #endif
@@ -0,0 +1,64 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Header:  Jobs.h
+ * Impl:    Jobs.cpp
+ * Purpose: Worker thread pool for data parallel engine passes
+ * Author:  Michael Herman
+ * */
+
+
+namespace CoreJobs {
+
+    // Called once per batch with the item range [begin, end).
+    // Batches are cut from the item count and batch size only, never from
+    // the worker count, so per batch outputs merged in batch order are
+    // identical for any number of threads.
+    typedef void (*JobFunction)(uint32_t batch, uint32_t begin, uint32_t end, void *context);
+
+    struct Job {
+        JobFunction function;
+        void *context;
+        uint32_t count;
+        uint32_t batchSize;
+        uint32_t batchCount;
+        std::atomic<uint32_t> nextBatch;
+        std::atomic<uint32_t> pendingBatches;
+        std::atomic<uint32_t> activeWorkers;
+    };
+
+    struct JobSystem {
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        Job *current = nullptr;
+        uint64_t generation = 0;
+        bool quit = false;
+    };
+
+    // workerCount 0 picks one worker per hardware thread besides the main one
+    bool JobsMake(uint32_t workerCount = 0);
+    bool JobsDestroy();
+    uint32_t WorkerCount();
+
+    inline uint32_t BatchCount(uint32_t count, uint32_t batchSize) {
+        return (count + batchSize - 1) / batchSize;
+    }
+
+    // Blocks until every batch ran, the calling thread works on batches too.
+    // Runs inline when there are no workers or a single batch.
+    void ParallelFor(uint32_t count, uint32_t batchSize, JobFunction function, void *context);
+
+}
+
+#endif
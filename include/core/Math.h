@@ -61,6 +61,18 @@ namespace CoreMath {
         };
     };
 
+    // 2D affine transform, the top two rows of the equivalent Matrix
+    // | m11 m12 m13 |  m13, m23 is the translation
+    // | m21 m22 m23 |
+    union Affine2D {
+        float f[6];
+        float m[2][3];
+        struct {
+            float m11, m12, m13;
+            float m21, m22, m23;
+        };
+    };
+
 }
 
 #endif
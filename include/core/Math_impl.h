@@ -2,36 +2,565 @@
 #define CORE_MATH_IMPL_H
 
 #include <core/Math.h>
+#include <cmath>
+#include <cstdint>
 #include <string>
 
 #define PI 3.14159265
 
+// SIMD backend, selected at compile time.
+// Define CORE_MATH_SCALAR to force the scalar fallback (build.ps1 -ScalarMath)
+#if !defined(CORE_MATH_SCALAR)
+    #if defined(__AVX2__)
+        #define CORE_MATH_AVX2 1
+    #endif
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define CORE_MATH_SSE2 1
+    #endif
+#endif
+
+#if CORE_MATH_AVX2
+#include <immintrin.h>
+#elif CORE_MATH_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * CoreMath is header only so that the small operations can be inlined
+ * at the call sites (SceneGraph, Geometry, Physics) without LTO.
+ * Only the string/debug helpers live in Math.cpp.
+ * */
+
 namespace CoreMath {
 
-    Vector2 CreateVector2(float x, float y);
-    Vector3 CreateVector3(float x, float y, float z);
-    Vector4 CreateVector4(float x, float y, float z, float w);
-    Vector2 VectorAdd(Vector2 &v1, Vector2 &v2);
-    Vector3 VectorAdd(Vector3 &v1, Vector3 &v2);
-    Vector4 VectorAdd(Vector4 &v1, Vector4 &v2);
-    Vector4 VectorScale(Vector4 &v1, float scale);
-    Vector2 VectorMul(Vector2 &v1, float multiplier);
-    Vector2 VectorSubtract(Vector2 &v1, Vector2 &v2);
-
-    float Dot(const Vector4 &v1, const Vector4 &v2);
-    Vector4 Cross(const Vector4 &v1, const Vector4 &v2);
-    Vector4 Normalize(const Vector4 &v);
-
-    Matrix CreateMatrix(float m[4][4]);
-    Matrix CreateTranslationMatrix(const Vector2 &offset);
-    Matrix CreateScaleMatrix(const Vector2 &scale);
-    Matrix CreateZRotationMatrix(float angle);
-    Matrix IdentityMatrix();
-    Matrix ViewSpaceMatrix(Vector4 pos, Vector4 up);
+    /*
+     * Vectors
+     * */
+
+    constexpr Vector2 CreateVector2(float x, float y) {
+        return Vector2{x, y};
+    }
+
+
+    constexpr Vector3 CreateVector3(float x, float y, float z) {
+        return Vector3{x, y, z};
+    }
+
+
+    constexpr Vector4 CreateVector4(float x, float y, float z, float w) {
+        return Vector4{x, y, z, w};
+    }
+
+
+    constexpr Vector2 VectorAdd(const Vector2 &v1, const Vector2 &v2) {
+        return Vector2{
+            v1.x + v2.x,
+            v1.y + v2.y,
+        };
+    }
+
+
+    constexpr Vector3 VectorAdd(const Vector3 &v1, const Vector3 &v2) {
+        return Vector3{
+            v1.x + v2.x,
+            v1.y + v2.y,
+            v1.z + v2.z,
+        };
+    }
+
+
+    constexpr Vector4 VectorAdd(const Vector4 &v1, const Vector4 &v2) {
+        return Vector4{
+            v1.x + v2.x,
+            v1.y + v2.y,
+            v1.z + v2.z,
+            v1.w + v2.w,
+        };
+    }
+
+
+    constexpr Vector4 VectorScale(const Vector4 &v1, float scale) {
+        return Vector4{
+            v1.x * scale,
+            v1.y * scale,
+            v1.z * scale,
+            v1.w * scale
+        };
+    }
+
+
+    constexpr Vector2 VectorMul(const Vector2 &v1, float multiplier) {
+        return Vector2{
+            v1.x * multiplier,
+            v1.y * multiplier,
+        };
+    }
+
+
+    constexpr Vector2 VectorSubtract(const Vector2 &v1, const Vector2 &v2) {
+        return Vector2{
+            v1.x - v2.x,
+            v1.y - v2.y,
+        };
+    }
+
+
+    constexpr float Dot(const Vector2 &v1, const Vector2 &v2) {
+        return (v1.x * v2.x) + (v1.y * v2.y);
+    }
+
+
+    // z component of the 3D cross product
+    constexpr float Cross(const Vector2 &v1, const Vector2 &v2) {
+        return (v1.x * v2.y) - (v1.y * v2.x);
+    }
+
+
+    inline float Length(const Vector2 &v) {
+        return std::sqrt((v.x * v.x) + (v.y * v.y));
+    }
+
+
+    // zero length vectors are returned as is
+    inline Vector2 Normalize(const Vector2 &v) {
+        float length = Length(v);
+        if(length == 0.0f) return v;
+        return Vector2{v.x / length, v.y / length};
+    }
+
+
+    inline float Dot(const Vector4 &v1, const Vector4 &v2) {
+#if CORE_MATH_SSE2
+        __m128 m = _mm_mul_ps(_mm_loadu_ps(v1.f), _mm_loadu_ps(v2.f));
+        __m128 s = _mm_add_ps(m, _mm_movehl_ps(m, m));                  // x+z, y+w
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1))); // (x+z)+(y+w)
+        return _mm_cvtss_f32(s);
+#else
+        return
+            (v1.x * v2.x) +
+            (v1.y * v2.y) +
+            (v1.z * v2.z) +
+            (v1.w * v2.w);
+#endif
+    }
+
+
+    inline Vector4 Cross(const Vector4 &v1, const Vector4 &v2) {
+        // x   y   z
+        //--------------
+        // Vx, Vy, Vz
+        // Wx, Wy, Wz
+#if CORE_MATH_SSE2
+        __m128 a = _mm_loadu_ps(v1.f);
+        __m128 b = _mm_loadu_ps(v2.f);
+        __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 c = _mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX));
+        Vector4 result;
+        _mm_storeu_ps(result.f, c);
+        result.w = 0.0f;
+        return result;
+#else
+        return Vector4{
+            ( v1.y * v2.z ) - ( v1.z * v2.y ),
+            ( v1.z * v2.x ) - ( v1.x * v2.z ),
+            ( v1.x * v2.y ) - ( v1.y * v2.x ),
+            0.0f
+        };
+#endif
+    }
+
+
+    inline Vector4 Normalize(const Vector4 &v) {
+#if CORE_MATH_SSE2
+        // length is taken from xyz only, w is scaled along like the scalar path
+        __m128 a = _mm_loadu_ps(v.f);
+        __m128 sq = _mm_mul_ps(a, a);
+        __m128 len = _mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1)));
+        len = _mm_add_ss(len, _mm_movehl_ps(sq, sq));
+        len = _mm_sqrt_ss(len);
+        len = _mm_shuffle_ps(len, len, _MM_SHUFFLE(0, 0, 0, 0));
+        Vector4 result;
+        _mm_storeu_ps(result.f, _mm_div_ps(a, len));
+        return result;
+#else
+        float length = std::sqrt( (v.x * v.x) + (v.y * v.y) + (v.z * v.z) );
+        return Vector4{
+            v.x / length,
+            v.y / length,
+            v.z / length,
+            v.w / length,
+        };
+#endif
+    }
+
+
+    /*
+     * Trigonometry
+     * */
+
+
+    // Float sine and cosine of an angle in radians, sharing one range reduction.
+    // The angle is reduced to [-pi, pi] then folded to [-pi/2, pi/2] where an
+    // 11 degree (sin) and 10 degree (cos) minimax polynomial is evaluated.
+    // Max abs error against std::sin/std::cos (evaluated in double) is
+    // below 4e-7 for |rad| <= 1e4, and about 2e-6 at |rad| = 1e5.
+    // Past 1e5, and for NaN and infinities, std::sin and std::cos are used.
+    inline void SinCos(float rad, float *s, float *c) {
+        // 2pi split in two (Cody-Waite) so that q * twoPiHi is exact
+        const float twoPiHi = 6.28125f;
+        const float twoPiLo = 0.00193530717958f;
+        const float halfPi = 1.57079632679f;
+        const float pi = 3.14159265359f;
+        const float maxRad = 1e5f;
+
+        // negated so NaN is caught too, the int cast below is only defined
+        // for quotients that fit and the reduction loses its error bound first
+        if(!(std::fabs(rad) <= maxRad)) {
+            *s = std::sin(rad);
+            *c = std::cos(rad);
+            return;
+        }
+
+        float quotient = rad * (1.0f / 6.28318530718f);
+        quotient = (float) (int) (quotient + (quotient >= 0.0f ? 0.5f : -0.5f));
+        float y = (rad - twoPiHi * quotient) - twoPiLo * quotient;
+
+        float sign = 1.0f;
+        if(y > halfPi) {
+            y = pi - y;
+            sign = -1.0f;
+        }else if(y < -halfPi) {
+            y = -pi - y;
+            sign = -1.0f;
+        }
+
+        float y2 = y * y;
+        *s = (((((-2.3889859e-08f * y2 + 2.7525562e-06f) * y2 - 0.00019840874f) * y2 + 0.0083333310f) * y2 - 0.16666667f) * y2 + 1.0f) * y;
+        *c = (((((-2.6051615e-07f * y2 + 2.4760495e-05f) * y2 - 0.0013888378f) * y2 + 0.041666638f) * y2 - 0.5f) * y2 + 1.0f) * sign;
+    }
+
+
+    // Batch form of SinCos, 4 angles per SSE2 iteration with a scalar tail.
+    // Same polynomial, error bound and range as the scalar version.
+    inline void SinCos(const float *rad, float *s, float *c, uint32_t count) {
+        uint32_t i = 0;
+#if CORE_MATH_SSE2
+        const __m128 twoPiHi = _mm_set1_ps(6.28125f);
+        const __m128 twoPiLo = _mm_set1_ps(0.00193530717958f);
+        const __m128 invTwoPi = _mm_set1_ps(1.0f / 6.28318530718f);
+        const __m128 halfPi = _mm_set1_ps(1.57079632679f);
+        const __m128 pi = _mm_set1_ps(3.14159265359f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        const __m128 maxRad = _mm_set1_ps(1e5f);
+        for(; i + 4 <= count; i += 4) {
+            __m128 x = _mm_loadu_ps(rad + i);
+            // not less or equal, so NaN lanes are outside as well
+            int outside = _mm_movemask_ps(_mm_cmpnle_ps(_mm_andnot_ps(signBit, x), maxRad));
+            // round to nearest (default MXCSR rounding)
+            __m128 quotient = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, invTwoPi)));
+            __m128 y = _mm_sub_ps(x, _mm_mul_ps(twoPiHi, quotient));
+            y = _mm_sub_ps(y, _mm_mul_ps(twoPiLo, quotient));
+
+            // fold to [-pi/2, pi/2]: y = copysign(pi, y) - y where |y| > pi/2
+            __m128 ySign = _mm_and_ps(y, signBit);
+            __m128 fold = _mm_cmpgt_ps(_mm_andnot_ps(signBit, y), halfPi);
+            __m128 folded = _mm_sub_ps(_mm_or_ps(pi, ySign), y);
+            y = _mm_or_ps(_mm_and_ps(fold, folded), _mm_andnot_ps(fold, y));
+            __m128 cosSign = _mm_or_ps(_mm_and_ps(fold, signBit), one);
+
+            __m128 y2 = _mm_mul_ps(y, y);
+            __m128 sp = _mm_set1_ps(-2.3889859e-08f);
+            sp = _mm_add_ps(_mm_mul_ps(sp, y2), _mm_set1_ps(2.7525562e-06f));
+            sp = _mm_add_ps(_mm_mul_ps(sp, y2), _mm_set1_ps(-0.00019840874f));
+            sp = _mm_add_ps(_mm_mul_ps(sp, y2), _mm_set1_ps(0.0083333310f));
+            sp = _mm_add_ps(_mm_mul_ps(sp, y2), _mm_set1_ps(-0.16666667f));
+            sp = _mm_add_ps(_mm_mul_ps(sp, y2), one);
+            _mm_storeu_ps(s + i, _mm_mul_ps(sp, y));
+
+            __m128 cp = _mm_set1_ps(-2.6051615e-07f);
+            cp = _mm_add_ps(_mm_mul_ps(cp, y2), _mm_set1_ps(2.4760495e-05f));
+            cp = _mm_add_ps(_mm_mul_ps(cp, y2), _mm_set1_ps(-0.0013888378f));
+            cp = _mm_add_ps(_mm_mul_ps(cp, y2), _mm_set1_ps(0.041666638f));
+            cp = _mm_add_ps(_mm_mul_ps(cp, y2), _mm_set1_ps(-0.5f));
+            cp = _mm_add_ps(_mm_mul_ps(cp, y2), one);
+            _mm_storeu_ps(c + i, _mm_mul_ps(cp, cosSign));
+
+            // cvtps gave 0x80000000 for these lanes, redone by the scalar form
+            if(outside) {
+                for(uint32_t k = 0; k < 4; k++) {
+                    if(outside & (1 << k)) SinCos(rad[i + k], &s[i + k], &c[i + k]);
+                }
+            }
+        }
+#endif
+        for(; i < count; i++) {
+            SinCos(rad[i], &s[i], &c[i]);
+        }
+    }
+
+
+    /*
+     * Matrices
+     * */
+
+
+    inline Matrix CreateMatrix(const float m[4][4]) {
+        Matrix mat;
+        for(int i = 0; i < 4; i++){
+            for(int j = 0; j < 4; j++){
+                mat.m[i][j] = m[i][j];
+            }
+        }
+        return mat;
+    }
+
+
+    constexpr Matrix CreateTranslationMatrix(const Vector2 &offset) {
+        return Matrix{
+            1.0f, 0.0f, 0.0f, offset.x,
+            0.0f, 1.0f, 0.0f, offset.y,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        };
+    }
+
+
+    constexpr Matrix CreateScaleMatrix(const Vector2 &scale) {
+        return Matrix{
+            scale.x, 0.0f, 0.0f, 0.0f,
+            0.0f, scale.y, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        };
+    }
+
+
+    constexpr Matrix IdentityMatrix() {
+        return Matrix{
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        };
+    }
+
+
+    inline Matrix CreateZRotationMatrix(float angle) {
+        float s, c;
+        SinCos(angle * (float) (PI / 180), &s, &c);
+        return Matrix{
+            c,    s,    0.0f, 0.0f,
+            -s,   c,    0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        };
+    }
+
+
+    inline Matrix ViewSpaceMatrix(const Vector4 &pos, const Vector4 &up) {
+        Vector4 w = Vector4{0.0f, 0.0f, 0.0f - pos.z, 0.0f};
+        Vector4 u = Normalize(Cross(w, up));
+        Vector4 v = Normalize(Cross(u, w));
+        return Matrix{
+            //u   v    w    q
+            u.x, v.x, w.x, -pos.x,
+            u.y, v.y, w.y, -pos.y,
+            u.z, v.z, w.z, pos.z,
+            0.0f, 0.0f, 0.0f, 1.0f
+        };
+    }
+
+
     Matrix ProjectionSpaceMatrix();
-    Matrix Multiply(const Matrix &A, const Matrix &B);
-    Vector4 Multiply(const Matrix &A, const Vector4 &V);
-    Matrix Transpose(const Matrix &A);
+
+
+    inline Matrix Multiply(const Matrix &A, const Matrix &B) {
+        Matrix result;
+#if CORE_MATH_AVX2
+        // two result rows per iteration, each 128 bit lane holds one row of A,
+        // result.r[i] = sum_k A[i][k] * B.r[k]
+        __m256 b0 = _mm256_broadcast_ps((const __m128*) B.r[0].f);
+        __m256 b1 = _mm256_broadcast_ps((const __m128*) B.r[1].f);
+        __m256 b2 = _mm256_broadcast_ps((const __m128*) B.r[2].f);
+        __m256 b3 = _mm256_broadcast_ps((const __m128*) B.r[3].f);
+        for(int i = 0; i < 4; i += 2) {
+            __m256 a = _mm256_loadu_ps(A.r[i].f);
+            __m256 r = _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x00), b0);
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x55), b1));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xAA), b2));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xFF), b3));
+            _mm256_storeu_ps(result.r[i].f, r);
+        }
+#elif CORE_MATH_SSE2
+        __m128 b0 = _mm_loadu_ps(B.r[0].f);
+        __m128 b1 = _mm_loadu_ps(B.r[1].f);
+        __m128 b2 = _mm_loadu_ps(B.r[2].f);
+        __m128 b3 = _mm_loadu_ps(B.r[3].f);
+        for(int i = 0; i < 4; i++) {
+            __m128 a = _mm_loadu_ps(A.r[i].f);
+            __m128 r = _mm_mul_ps(_mm_shuffle_ps(a, a, 0x00), b0);
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0x55), b1));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xAA), b2));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xFF), b3));
+            _mm_storeu_ps(result.r[i].f, r);
+        }
+#else
+        for(int i = 0; i < 4; i++){
+            for(int j = 0; j < 4; j++){
+                float sum = 0.0f;
+                for(int k = 0; k < 4; k++){
+                    float a = A.m[i][k];
+                    float b = B.m[k][j];
+                    sum += (a * b);
+                }
+                result.m[i][j] = sum;
+            }
+        }
+#endif
+        return result;
+    }
+
+
+    inline Vector4 Multiply(const Matrix &A, const Vector4 &B) {
+#if CORE_MATH_SSE2
+        // transpose so that the result is a sum of columns scaled by V
+        __m128 c0 = _mm_loadu_ps(A.r[0].f);
+        __m128 c1 = _mm_loadu_ps(A.r[1].f);
+        __m128 c2 = _mm_loadu_ps(A.r[2].f);
+        __m128 c3 = _mm_loadu_ps(A.r[3].f);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        __m128 v = _mm_loadu_ps(B.f);
+        __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, 0x00));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, 0x55)));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, 0xAA)));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, 0xFF)));
+        Vector4 result;
+        _mm_storeu_ps(result.f, r);
+        return result;
+#else
+        return Vector4{
+            Dot(A.r[0], B),
+            Dot(A.r[1], B),
+            Dot(A.r[2], B),
+            Dot(A.r[3], B)
+        };
+#endif
+    }
+
+
+    inline Matrix Transpose(const Matrix &A) {
+        Matrix result;
+#if CORE_MATH_SSE2
+        __m128 r0 = _mm_loadu_ps(A.r[0].f);
+        __m128 r1 = _mm_loadu_ps(A.r[1].f);
+        __m128 r2 = _mm_loadu_ps(A.r[2].f);
+        __m128 r3 = _mm_loadu_ps(A.r[3].f);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(result.r[0].f, r0);
+        _mm_storeu_ps(result.r[1].f, r1);
+        _mm_storeu_ps(result.r[2].f, r2);
+        _mm_storeu_ps(result.r[3].f, r3);
+#else
+        for(int i = 0; i < 4; i++){
+            for(int j = 0; j < 4; j++){
+                result.m[i][j] = A.m[j][i];
+            }
+        }
+#endif
+        return result;
+    }
+
+
+    /*
+     * 2D Affine
+     * */
+
+
+    constexpr Affine2D IdentityAffine2D() {
+        return Affine2D{
+            1.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f
+        };
+    }
+
+
+    // Same as T * R * S with the 4x4 matrices, from an already known sin/cos pair
+    constexpr Affine2D CreateAffine2D(const Vector2 &pos, const Vector2 &scale, float s, float c) {
+        return Affine2D{
+            c * scale.x,  s * scale.y, pos.x,
+            -s * scale.x, c * scale.y, pos.y
+        };
+    }
+
+
+    inline Affine2D CreateAffine2D(const Vector2 &pos, const Vector2 &scale, float angle) {
+        float s, c;
+        SinCos(angle * (float) (PI / 180), &s, &c);
+        return CreateAffine2D(pos, scale, s, c);
+    }
+
+
+    // A * B, applies B first then A
+    inline Affine2D Multiply(const Affine2D &A, const Affine2D &B) {
+        return Affine2D{
+            A.m11 * B.m11 + A.m12 * B.m21,
+            A.m11 * B.m12 + A.m12 * B.m22,
+            A.m11 * B.m13 + A.m12 * B.m23 + A.m13,
+            A.m21 * B.m11 + A.m22 * B.m21,
+            A.m21 * B.m12 + A.m22 * B.m22,
+            A.m21 * B.m13 + A.m22 * B.m23 + A.m23
+        };
+    }
+
+
+    // Caller is responsible for non zero scale
+    inline Affine2D Inverse(const Affine2D &A) {
+        float invDet = 1.0f / (A.m11 * A.m22 - A.m12 * A.m21);
+        float i11 =  A.m22 * invDet;
+        float i12 = -A.m12 * invDet;
+        float i21 = -A.m21 * invDet;
+        float i22 =  A.m11 * invDet;
+        return Affine2D{
+            i11, i12, -(i11 * A.m13 + i12 * A.m23),
+            i21, i22, -(i21 * A.m13 + i22 * A.m23)
+        };
+    }
+
+
+    inline Vector2 TransformPoint(const Affine2D &A, const Vector2 &p) {
+        return Vector2{
+            A.m11 * p.x + A.m12 * p.y + A.m13,
+            A.m21 * p.x + A.m22 * p.y + A.m23
+        };
+    }
+
+
+    inline Vector2 TransformVector(const Affine2D &A, const Vector2 &v) {
+        return Vector2{
+            A.m11 * v.x + A.m12 * v.y,
+            A.m21 * v.x + A.m22 * v.y
+        };
+    }
+
+
+    // Expand to the 4x4 layout expected by the graphics constants
+    inline Matrix ToMatrix(const Affine2D &A) {
+        return Matrix{
+            A.m11, A.m12, 0.0f, A.m13,
+            A.m21, A.m22, 0.0f, A.m23,
+            0.0f,  0.0f,  1.0f, 0.0f,
+            0.0f,  0.0f,  0.0f, 1.0f
+        };
+    }
+
+
+    /*
+     * Debug helpers (Math.cpp)
+     * */
 
     std::string VectorToString(const Vector4 &v);
     std::string VectorToString(const Vector3 &v);
@@ -1,10 +1,30 @@
 #ifndef PHYSICS_FWD_H
 #define PHYSICS_FWD_H
 
+#include <cstdint>
+
 namespace CorePhysics {
     struct World;
-    struct Collider;
-    struct BoxCollider;
+    struct ContactEvent;
+
+    // Slot of the collider and the generation the slot had when it was
+    // created, the handle stops resolving once the collider is destroyed
+    // even after the slot is reused
+    struct ColliderHandle {
+        uint32_t index;
+        uint32_t generation; // 0 is never live
+    };
+
+    const ColliderHandle INVALID_COLLIDER = {0xFFFFFFFF, 0};
+
+    const uint32_t DEFAULT_CATEGORY = 1;
+    const uint32_t ALL_CATEGORIES = 0xFFFFFFFF;
+
+    // Two colliders collide when each one's categories match the other's mask
+    struct CollisionFilter {
+        uint32_t categories = DEFAULT_CATEGORY;
+        uint32_t mask = ALL_CATEGORIES;
+    };
 }
 
 #endif
@@ -3,6 +3,8 @@
 
 // #include <core/Physics.fwd.h>
 #include <core/GameObject.h>
+#include <core/DSA.h>
+#include <vector>
 
 /*
  * Header:  Physics.h
@@ -14,38 +16,316 @@
 
 namespace CorePhysics {
 
-    enum ColliderType{
-        BOX_COLLIDER
+    enum ColliderFlags {
+        COLLIDER_ACTIVE   = 1 << 0, // integrated and collided
+        COLLIDER_VISIBLE  = 1 << 1,
+        COLLIDER_STATIC   = 1 << 2, // never integrated, never tested against other static colliders
+        COLLIDER_SLEEPING = 1 << 3, // set by the sleep pass, woken with its whole island
+        COLLIDER_DIRTY    = 1 << 4, // bounds need a recompute even if static or sleeping
+        COLLIDER_BULLET   = 1 << 5, // swept bounds and time of impact against non bullets
+        COLLIDER_SENSOR   = 1 << 6  // trigger volume, reports overlaps but is never solved
     };
 
-    struct Collider {
-        ColliderType type;
-        GameObject::Transform2D transform;
-        Vector2 velocity;
-        bool visible = false;
+    enum BroadphaseType {
+        BROADPHASE_GRID, // rebuilt from every collider each step, for scenes where nearly everything moves
+        BROADPHASE_TREE  // default, dynamic AABB tree, static and sleeping colliders cost nothing
+    };
+
+    // No collider, for dense indices and handle slots
+    const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+    /*
+     * Uniform spatial hash used by the broadphase and the world queries.
+     * Entries are (cell, collider) pairs sorted by cell, an open addressing
+     * table points every occupied cell to its first entry in the sorted run.
+     * Rebuilt every step for the broadphase and lazily for queries, all
+     * storage is kept across rebuilds. Colliders spanning too many cells
+     * are kept out of the cells and paired and queried on their own.
+     * Cells should be around the size of a typical collider.
+     * */
+    struct GridEntry {
+        uint64_t cell;
+        uint32_t collider;
+    };
+
+    struct GridCell {
+        uint64_t key;
+        uint32_t first; // first entry of the cell
+        uint32_t stamp; // slot is occupied when it matches the grid stamp
+    };
+
+    struct SpatialGrid {
+        float cellSize = 64.0f;
+        std::vector<GridEntry> entries;
+        std::vector<uint32_t> runs;      // first entry of every occupied cell, then entries.size()
+        std::vector<GridCell> cells;     // power of two slots, at most half occupied
+        uint32_t stamp = 0;
+        std::vector<uint32_t> oversized; // colliders kept out of the cells
+        CoreGeometry::BoundingRect extent; // union of all bounds
+    };
+
+    // Candidate pair from the broadphase, dense indices with a < b
+    struct ColliderPair {
+        uint32_t a;
+        uint32_t b;
+    };
+
+    /*
+     * Persistent contact between two touching colliders. Contacts are keyed
+     * by the handle pair so the accumulated impulses of the last step can be
+     * found again and used to warm start the solver.
+     * */
+    struct Contact {
+        uint64_t key;  // smaller handle slot << 32 | larger handle slot
+        uint32_t a;    // dense indices, only valid during the step
+        uint32_t b;
+        CoreGeometry::Manifold manifold;
+        float normalImpulses[2];  // accumulated along manifold.normal
+        float tangentImpulses[2]; // accumulated along the normal turned clockwise
+        float velocityBiases[2];  // restitution and penetration recovery
+        float mass;               // 1 / (inverse mass a + inverse mass b)
+        float friction;
+        float restitution;
+    };
+
+    enum ContactEventType {
+        CONTACT_BEGIN,
+        CONTACT_STAY,
+        CONTACT_END,
+        TRIGGER_BEGIN,
+        TRIGGER_END
+    };
+
+    // Seen from collider, the normal points from collider to other.
+    // End events carry no normal or point.
+    struct ContactEvent {
+        ContactEventType type;
+        ColliderHandle collider;
+        ColliderHandle other;
         GameObject::Empty *owner;
+        GameObject::Empty *otherOwner;
+        Vector2 normal;
+        Vector2 point;
     };
 
-    struct World {
-        std::vector<Collider*> colliders;
+    // Offset InterpolatePass added to an owner local position
+    struct Interpolation {
+        ColliderHandle collider;
+        Vector2 offset;
+    };
+
+    // Touching pair of a step, key as in Contact
+    struct Touch {
+        uint64_t key;
+        uint32_t pair;   // index in pairs, INVALID_INDEX when carried over from a resting pair
+        uint32_t sensor; // non zero for trigger overlaps
     };
 
-    struct BoxCollider : Collider {
-        CoreGeometry::BoundingRect AABB;
+    /*
+     * Colliders are stored as parallel dense arrays so the per step passes
+     * stream through memory. Removal swaps the last collider into the hole,
+     * game code keeps a ColliderHandle which stays valid across swaps.
+     * Inside the world colliders are named by their handle slot alone,
+     * handles are checked once at the API.
+     * Positions are world space centers. Step pulls the owner moves made by
+     * game code and pushes the simulated displacement back by the sync pass.
+     * */
+    struct World {
+        // dense, parallel
+        std::vector<Vector2> positions;    // current state
+        std::vector<Vector2> previousPositions; // state before the last fixed step
+        std::vector<Vector2> velocities;   // units per second
+        std::vector<float> inverseMasses;  // 0 moves kinematically, pushed by nothing
+        std::vector<float> frictions;
+        std::vector<float> restitutions;
+        std::vector<Vector2> syncPositions; // position last exchanged with the owner
+        std::vector<Vector2> syncLocals;   // owner local position at that exchange
+        std::vector<CoreGeometry::BoundingRect> bounds;
+        std::vector<CoreGeometry::Shape> shapes;
+        std::vector<uint32_t> flags;
+        std::vector<float> sleepTimers;    // seconds spent below the sleep velocity
+        std::vector<uint32_t> sleepIslands; // island a sleeping collider went to sleep with
+        std::vector<uint32_t> categories;  // one or more category bits, matched against masks
+        std::vector<uint32_t> masks;       // categories this collider collides with
+        std::vector<GameObject::Empty*> owners;
+        std::vector<uint32_t> handles; // dense -> handle slot
+
+        // sparse, by handle slot
+        std::vector<uint32_t> denseIndex;  // dense index or INVALID_INDEX
+        std::vector<uint32_t> generations; // of the live collider, bumped on destroy
+        std::vector<uint32_t> freeHandles;
+
+        // fixed step scheduler
+        double fixedStep = 1.0 / 60.0;
+        double accumulator = 0.0;
+        uint32_t maxSubsteps = 4;
+        uint32_t droppedSteps = 0; // total steps skipped to keep up
+        float alpha = 0.0f;        // interpolation between previous and current state
+        std::vector<Interpolation> interpolations; // owners moved to the drawn pose until RestorePass
+
+        // solver
+        Vector2 gravity = {0.0f, 0.0f};
+        uint32_t velocityIterations = 8;
+        bool warmStarting = true;
+        std::vector<Contact> contacts;         // touching pairs of the current step, pair order
+        std::vector<Contact> previousContacts; // last step, sorted by key
+
+        // events of the last Step, reused so dispatch never allocates
+        std::vector<ContactEvent> events;
+        std::vector<Touch> touches;         // sorted by key
+        std::vector<Touch> previousTouches;
+        std::vector<Touch> carriedTouches;  // resting pairs kept by the event pass
+
+        // sleeping
+        bool allowSleep = true;
+        float sleepVelocity = 2.0f; // units per second
+        float timeToSleep = 0.5f;   // seconds an island must stay below sleepVelocity
+        std::vector<uint32_t> wakeIslands;  // islands to wake before the next solve
+        std::vector<uint32_t> awakeHandles; // awake dynamic colliders, follows the flags
+        std::vector<uint32_t> awakeSlots;   // handle slot -> index in awakeHandles or INVALID_INDEX
+        std::vector<uint32_t> sleptHandles; // fell asleep during the step, synced once more
+        std::vector<uint32_t> dirtyHandles; // marked COLLIDER_DIRTY since the last bounds sync
+        std::vector<ColliderHandle> movedOwners;  // owners moved by game code since the last pull
+
+        std::vector<ColliderPair> pairs; // broadphase output of the current step, sorted
+        BroadphaseType broadphase = BROADPHASE_TREE;
+        SpatialGrid grid;
+        CoreDSA::DynamicTree tree;
+        std::vector<int32_t> proxies; // tree proxy per dense collider
+        bool boundsDirty = true;
+        // parallel step scratch, reused across steps
+        std::vector<std::vector<ColliderPair>> batchPairs;
+        std::vector<std::vector<CoreDSA::ProxyPair>> batchProxyPairs;
+        std::vector<uint32_t> boundsList;        // colliders whose bounds the sync recomputes
+        std::vector<Vector2> boundsMotion;       // their bounds center motion, parallel to boundsList
+        std::vector<uint32_t> touchList;         // proxies to query again, woken or flags changed
+        std::vector<CoreGeometry::Manifold> manifolds; // parallel to pairs
+        std::vector<uint8_t> touching;           // parallel to pairs
+        std::vector<uint32_t> islandParent;      // union find over colliders, only awake and contact entries are set
+        std::vector<uint64_t> islandContacts;    // island root << 32 | contact index, sorted
+        std::vector<uint32_t> islandStarts;      // island ranges in islandContacts
+        std::vector<float> islandSleepTimes;     // min sleep timer per island root
+        std::vector<uint64_t> bulletPairs;       // bullet << 32 | other collider, sorted
+        std::vector<uint32_t> bulletStarts;      // bullet ranges in bulletPairs
+        // per collider stamp so a collider spanning many cells is tested once per query
+        std::vector<uint32_t> queryStamps;
+        uint32_t queryStamp = 0;
+        // bumped by every collider create and destroy, snapshots restore into the same version only
+        uint32_t structureVersion = 0;
     };
 
-    struct RayCast {};
+    struct RaycastHit {
+        ColliderHandle collider;
+        GameObject::Empty *owner;
+        float distance;
+        Vector2 point;
+        Vector2 normal;
+    };
 
     bool WorldMake();
     bool WorldDestroy();
 
-    BoxCollider* CreateBoxCollider(
-        // GameObject::Transform2D &transform,
+    // The collision filter is taken from the owner, the default filter without one
+    ColliderHandle CreateCollider(
         GameObject::Empty *gameObject,
-        CoreGeometry::BoundingRect &boundingRect
+        const CoreGeometry::Shape &shape
         );
-    void RegisterCollider(Collider *collider);
+    // Box shape sized after the bounding rect, centered on the owner
+    ColliderHandle CreateBoxCollider(
+        GameObject::Empty *gameObject,
+        const CoreGeometry::BoundingRect &boundingRect
+        );
+    void DestroyCollider(ColliderHandle handle);
+    bool IsValidCollider(ColliderHandle handle);
+
+    Vector2 GetVelocity(ColliderHandle handle);
+    void SetVelocity(ColliderHandle handle, const Vector2 &velocity);
+    Vector2 GetPosition(ColliderHandle handle);
+    // Pairs rejected by the filter never reach the narrowphase
+    void SetCollisionFilter(ColliderHandle handle, const CollisionFilter &filter);
+    CollisionFilter GetCollisionFilter(ColliderHandle handle);
+    void SetColliderFlags(ColliderHandle handle, uint32_t flags);
+    void SetStatic(ColliderHandle handle, bool isStatic);
+    // mass 0 makes a kinematic collider, moved by its velocity only
+    void SetMass(ColliderHandle handle, float mass);
+    void SetMaterial(ColliderHandle handle, float friction, float restitution);
+    // Bullets are swept through the step so they cannot pass through thin colliders
+    void SetBullet(ColliderHandle handle, bool isBullet);
+    void SetSensor(ColliderHandle handle, bool isSensor);
+    bool IsSleeping(ColliderHandle handle);
+    void WakeCollider(ColliderHandle handle);
+    // Called by the transform setters, the next Step pulls the owner move
+    void MarkOwnerMoved(ColliderHandle handle);
+    void SetSleepThresholds(float sleepVelocity, float timeToSleep, bool allowSleep = true);
+
     void Step(double deltaTime);
+    // Blends owners between the last two steps for drawing, called by the
+    // scene update pass between the behaviors and the transform propagation
+    void InterpolatePass();
+    // Undoes InterpolatePass, after drawing and before any game code runs
+    void RestorePass();
+    // Calls behavior.OnContact of both owners for every event of the last Step
+    void DispatchContactEvents();
+    const std::vector<ContactEvent>& GetContactEvents();
+    void SetFixedStep(double seconds);
+    void SetMaxSubsteps(uint32_t maxSubsteps);
+    float GetInterpolationAlpha();
+    // Total whole steps skipped because a frame needed more than maxSubsteps
+    uint32_t GetDroppedSteps();
+    void SetBroadphase(BroadphaseType type);
+
+    /*
+     * Snapshots for rollback and replays. A snapshot holds the state a step
+     * changes, settings such as gravity or the fixed step and the shapes are
+     * not saved. Creating or destroying a collider changes the structure of
+     * the world, snapshots taken before are rejected by RestoreSnapshot.
+     * */
+
+    typedef void (*ResimulateCallback)(uint32_t step, void *context);
+
+    // Overwrites buffer, its capacity is kept so saving every frame does not allocate
+    void SaveSnapshot(std::vector<uint8_t> &buffer);
+    bool RestoreSnapshot(const uint8_t *data, size_t size);
+    // Runs exactly steps fixed steps, beforeStep is the place to apply inputs
+    void Resimulate(uint32_t steps, ResimulateCallback beforeStep = nullptr, void *context = nullptr);
+    void SetGravity(const Vector2 &gravity);
+    void SetSolverIterations(uint32_t velocityIterations, bool warmStarting = true);
+    void SetBroadphaseCellSize(float cellSize);
+
+    /*
+     * Queries
+     * Run against the broadphase of CoreGlobals::physicsWorld,
+     * only colliders with a category bit in categoryMask are reported.
+     * */
+
+    // Closest hit along the ray, direction does not need to be normalized
+    bool Raycast(
+        const Vector2 &origin,
+        const Vector2 &direction,
+        float maxDistance,
+        RaycastHit *hit,
+        uint32_t categoryMask = ALL_CATEGORIES
+        );
+    // Every hit along the ray sorted by distance, returns the hit count
+    uint32_t RaycastAll(
+        const Vector2 &origin,
+        const Vector2 &direction,
+        float maxDistance,
+        std::vector<RaycastHit> &hits,
+        uint32_t categoryMask = ALL_CATEGORIES
+        );
+    // Colliders whose shape overlaps the rect
+    uint32_t OverlapAABB(
+        const CoreGeometry::BoundingRect &rect,
+        std::vector<ColliderHandle> &results,
+        uint32_t categoryMask = ALL_CATEGORIES
+        );
+    // Colliders whose shape contains the point
+    uint32_t OverlapPoint(
+        const Vector2 &point,
+        std::vector<ColliderHandle> &results,
+        uint32_t categoryMask = ALL_CATEGORIES
+        );
 
 
 }
@@ -3,6 +3,7 @@
 
 #include <core/GameResource_impl.h>
 #include <core/GameObject_impl.h>
+#include <core/DSA.h>
 
 
 /*
@@ -19,6 +20,63 @@ using namespace GameResource;
 
 namespace SceneGraph {
 
+    /*
+     * Flat pre-order copy of the node tree. Parents come before their
+     * children and the subtree of node i is the range [i, i + subtreeSizes[i]).
+     * Siblings are stored last attached first, the order the old stack
+     * traversal visited them in. Kept up to date by AttachTo and Detach.
+     * */
+    struct Hierarchy {
+        std::vector<Node2D*> nodes;
+        std::vector<int32_t> parents;       // index in nodes, -1 for the root
+        std::vector<uint32_t> subtreeSizes; // node included
+    };
+
+    /*
+     * Draw keys
+     * Visible nodes are drawn in ascending key order. From the high bits down:
+     * layer 8 | zIndex 16 | shader 10 | material 12 | texture 10 | depth 8.
+     * zIndex is biased so negative values sort first, resource bits are the
+     * resource sortId and depth is the world z, clamped to [0, 255].
+     * Equal keys keep their hierarchy order.
+     * */
+    struct DrawKey {
+        uint64_t key;
+        uint32_t order; // hierarchy index, sorted on first
+        Node2D *node;
+    };
+
+    uint64_t MakeDrawKey(Node2D *node);
+
+    /*
+     * Update span
+     * Contiguous range of the hierarchy whose nodes only depend on earlier
+     * nodes of the same span or on serial heads, the nodes with a subtree
+     * too large to fit in one span. Spans are cut again only when the
+     * hierarchy changes. Every frame the dirty subtrees are split into
+     * ranges over the spans they cross, only spans with a range run. Heads
+     * are updated first on the calling thread, then the other spans in
+     * parallel, each into its own lists. Lists are applied to the spatial
+     * index in span order, so the index is built the same way for any
+     * worker count.
+     * */
+    struct UpdateSpan {
+        uint32_t begin;
+        uint32_t end;
+        bool head;
+        uint32_t frame;  // scene frame the ranges were gathered for
+        std::vector<uint32_t> ranges; // begin, end pairs of dirty subtree parts, ascending
+        uint32_t transformsUpdated;
+        // drawables that moved, gathered contiguously so that the AABB
+        // update runs as one tight loop
+        std::vector<Node2D*> dirtyNodes;
+        std::vector<GameObject::Geometry2D*> dirtyGeometry;
+        std::vector<Affine2D> transforms;
+        std::vector<Vector2> halfExtents;
+        std::vector<CoreGeometry::BoundingRect> dirtyBounds;
+        std::vector<Vector2> displacements; // bounds center motion, stretches the index leaf
+    };
+
     struct Scene {
         std::string id;
         std::string name;
@@ -27,13 +85,51 @@ namespace SceneGraph {
         GameObject::Camera *activeCamera;
         Node2D *sceneRoot;
         // std::vector<Node2D*> sceneObjects;
+        Hierarchy hierarchy;
+        Hierarchy spliceScratch; // subtree being attached, reused
+
+        uint32_t frame = 0;              // UpdatePass count
+        uint32_t transformsUpdated = 0;  // transforms recomputed by the last UpdatePass
+
+        // nodes whose transform was set since the last UpdatePass, filled by
+        // QueueTransform, so a frame costs what moved and not the level size
+        std::vector<Node2D*> dirtyNodes;
+        std::vector<uint32_t> dirtyRoots; // dirty nodes without a dirty ancestor, scratch
+
+        // Cut from the hierarchy on the first UpdatePass after AttachTo or
+        // Detach changed it, kept as is otherwise: the hierarchy cut into
+        // spans that are updated on the job workers, the cameras and the
+        // nodes with an Update behavior.
+        bool structureChanged = true;
+        std::vector<UpdateSpan> spans;
+        uint32_t spanCount = 0;
+        std::vector<uint32_t> activeSpans; // spans with a dirty range this frame, ascending
+        std::vector<GameObject::Camera*> cameras;
+        std::vector<Node2D*> updatables;
+        // World bounds of every drawable in the scene, leaves are only
+        // touched when their node moved. Culling queries it with the camera
+        // rect so its cost follows what is on screen, not the level size.
+        CoreDSA::DynamicTree spatialIndex;
+        std::vector<Node2D*> indexedNodes; // by proxy
+        // culling scratch, index hits and their tight bounds
+        std::vector<Node2D*> candidates;
+        std::vector<CoreGeometry::BoundingRect> candidateBounds;
+        std::vector<uint32_t> visible;
+        // draw keys of the visible nodes and the radix sort ping-pong buffer
+        std::vector<DrawKey> drawKeys;
+        std::vector<DrawKey> sortScratch;
     };
 
     void Init();
     std::string GenerateSceneID();
     Node2D* GetSceneRoot(Scene **scene);
     std::vector<Node2D*> GetSceneNodesByName(Scene **scene, std::string name);
+    // Moves child with its subtree under parent, detaching it first if needed
     bool AttachTo(Node2D *parent, Node2D *child);
+    bool Detach(Node2D *child);
+    // Takes node with its subtree out of its scene and keeps the links to its
+    // parent, removing the scene root leaves the scene empty
+    bool RemoveFromScene(Node2D *node);
 
     Scene* CreateScene(
         std::string name,
@@ -47,8 +143,13 @@ namespace SceneGraph {
     void UpdatePass(Scene *scene, unsigned int fps, double deltaTime);
     void ShutdownPass(Scene *scene);
     void DrawPass(Scene *scene);
+    uint32_t GetUpdatedTransformCount(Scene *scene);
+    // Marks the transform dirty and queues the node on the dirty list of
+    // its scene, called by the GameObject transform setters
+    void QueueTransform(Node2D *node);
     // void DrawPass(Scene *debugdraw);
-    void SortSceneDrawable(std::vector<Node2D*> &drawable);
+    // Sorts scene->drawKeys by key and writes the nodes to scene->drawable
+    void SortSceneDrawable(Scene *scene);
 
 }
 
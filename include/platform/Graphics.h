@@ -7,6 +7,7 @@
 /*
  * Header:  Graphics.h
  * Impl:    Graphics_d3d.cpp
+ *          Graphics_null.cpp
  *          Graphics_metal.cpp (not yet made)
  * Purpose: Interface bridging platform & platform independent layer
  * Author:  Michael Herman
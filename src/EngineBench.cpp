@@ -0,0 +1,716 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <vector>
+
+#include <core/Math_impl.h>
+#include <core/CoreGlobals.h>
+
+/*
+ * Header:  NONE
+ * Impl:    EngineBench.cpp
+ * Purpose: Standalone accuracy checks and microbenchmarks for the engine core
+ * Author:  Michael Herman
+ * */
+
+using namespace std;
+
+// A case returns false when one of its checks fails
+typedef bool (*BenchCase)();
+
+struct Bench {
+    const char *name;
+    BenchCase run;
+};
+
+
+/*
+ * Helpers
+ * Timing is the best of a few repetitions so that a single
+ * scheduler hiccup does not show up in the report.
+ * */
+static const uint32_t BENCH_REPEAT = 5;
+
+static double Now() {
+    return chrono::duration<double, milli>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename Function>
+static double BestOf(Function function) {
+    double best = 1e30;
+    for(uint32_t i = 0; i < BENCH_REPEAT; i++) {
+        double start = Now();
+        function();
+        double elapsed = Now() - start;
+        if(elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+static void Report(const char *label, double ms, uint32_t count) {
+    printf("  %-40s %10.3f ms %10.2f ns/op\n", label, ms, ms * 1e6 / count);
+}
+
+static const char *MathBackend() {
+#if CORE_MATH_AVX2
+    return "AVX2";
+#elif CORE_MATH_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+// Keeps the optimizer from dropping a loop whose results are unused
+static volatile float sink;
+
+
+/*
+ * SinCos
+ * Max abs error of the scalar and batch forms against std::sin/std::cos
+ * evaluated in double, then both forms timed against std::sin + std::cos.
+ * Angles past the reduction range, NaN and infinities must match libm.
+ * */
+static const float SINCOS_RANGE = 1e4f;
+static const double SINCOS_TOLERANCE = 4e-7;
+static const uint32_t SINCOS_COUNT = 1 << 20;
+
+static bool SinCosAccuracy() {
+    vector<float> rad(SINCOS_COUNT), s(SINCOS_COUNT), c(SINCOS_COUNT);
+    for(uint32_t i = 0; i < SINCOS_COUNT; i++) {
+        rad[i] = -SINCOS_RANGE + 2.0f * SINCOS_RANGE * ((float) i / (SINCOS_COUNT - 1));
+    }
+
+    double scalarError = 0.0;
+    for(uint32_t i = 0; i < SINCOS_COUNT; i++) {
+        float si, ci;
+        CoreMath::SinCos(rad[i], &si, &ci);
+        scalarError = fmax(scalarError, fabs(si - sin((double) rad[i])));
+        scalarError = fmax(scalarError, fabs(ci - cos((double) rad[i])));
+    }
+
+    double batchError = 0.0;
+    CoreMath::SinCos(rad.data(), s.data(), c.data(), SINCOS_COUNT);
+    for(uint32_t i = 0; i < SINCOS_COUNT; i++) {
+        batchError = fmax(batchError, fabs(s[i] - sin((double) rad[i])));
+        batchError = fmax(batchError, fabs(c[i] - cos((double) rad[i])));
+    }
+
+    printf("  scalar max error %.3g, batch max error %.3g (tolerance %.3g, |rad| <= %g)\n",
+        scalarError, batchError, SINCOS_TOLERANCE, SINCOS_RANGE);
+
+    // one lane out of range per batch of 4, the others reduced as usual
+    const float edges[] = {
+        NAN, 1.0f, 2.0f, 3.0f,
+        INFINITY, -1.0f, -2.0f, -3.0f,
+        -INFINITY, 0.5f, 1.5f, 2.5f,
+        3e9f, -0.5f, -1.5f, -2.5f,
+        -1e20f, 4.0f, 5.0f, 6.0f,
+        2e5f
+    };
+    const uint32_t edgeCount = sizeof(edges) / sizeof(edges[0]);
+    float edgeS[edgeCount], edgeC[edgeCount];
+    CoreMath::SinCos(edges, edgeS, edgeC, edgeCount);
+    uint32_t edgeMismatches = 0;
+    for(uint32_t i = 0; i < edgeCount; i++) {
+        float si, ci;
+        CoreMath::SinCos(edges[i], &si, &ci);
+        double expectedS = sin((double) edges[i]);
+        double expectedC = cos((double) edges[i]);
+        bool matches = std::isnan(expectedS)
+            ? std::isnan(si) && std::isnan(ci) && std::isnan(edgeS[i]) && std::isnan(edgeC[i])
+            : fabs(si - expectedS) <= SINCOS_TOLERANCE && fabs(ci - expectedC) <= SINCOS_TOLERANCE
+                && fabs(edgeS[i] - expectedS) <= SINCOS_TOLERANCE && fabs(edgeC[i] - expectedC) <= SINCOS_TOLERANCE;
+        if(!matches) edgeMismatches++;
+    }
+    printf("  %u of %u NaN, infinite and out of range angles mismatched\n", edgeMismatches, edgeCount);
+    return scalarError <= SINCOS_TOLERANCE && batchError <= SINCOS_TOLERANCE && edgeMismatches == 0;
+}
+
+static bool SinCosSpeed() {
+    vector<float> rad(SINCOS_COUNT), s(SINCOS_COUNT), c(SINCOS_COUNT);
+    for(uint32_t i = 0; i < SINCOS_COUNT; i++) {
+        rad[i] = -SINCOS_RANGE + 2.0f * SINCOS_RANGE * ((float) i / (SINCOS_COUNT - 1));
+    }
+
+    double libm = BestOf([&]() {
+        for(uint32_t i = 0; i < SINCOS_COUNT; i++) {
+            s[i] = sinf(rad[i]);
+            c[i] = cosf(rad[i]);
+        }
+        sink = s[SINCOS_COUNT / 2] + c[SINCOS_COUNT / 3];
+    });
+    double scalar = BestOf([&]() {
+        for(uint32_t i = 0; i < SINCOS_COUNT; i++) {
+            CoreMath::SinCos(rad[i], &s[i], &c[i]);
+        }
+        sink = s[SINCOS_COUNT / 2] + c[SINCOS_COUNT / 3];
+    });
+    double batch = BestOf([&]() {
+        CoreMath::SinCos(rad.data(), s.data(), c.data(), SINCOS_COUNT);
+        sink = s[SINCOS_COUNT / 2] + c[SINCOS_COUNT / 3];
+    });
+
+    Report("std::sin + std::cos", libm, SINCOS_COUNT);
+    Report("CoreMath::SinCos", scalar, SINCOS_COUNT);
+    Report("CoreMath::SinCos (batch)", batch, SINCOS_COUNT);
+    return true;
+}
+
+
+/*
+ * Node transforms
+ * The per node work of SceneGraph::UpdatePass on the 4x4 path: world = parent * local,
+ * then the four bounding corners through Multiply(Matrix, Vector4), run with the
+ * compiled CoreMath backend and with a plain scalar copy of the same loops.
+ * Nodes are stored parent first with four children per parent.
+ * */
+static const uint32_t NODE_COUNTS[] = {10000, 100000};
+static const float NODE_TOLERANCE = 1e-4f;
+
+struct NodeScene {
+    vector<uint32_t> parent;
+    vector<CoreMath::Matrix> local;
+    vector<CoreMath::Matrix> world;
+    vector<CoreMath::Vector4> corners;
+};
+
+static CoreMath::Matrix ScalarMultiply(const CoreMath::Matrix &A, const CoreMath::Matrix &B) {
+    CoreMath::Matrix result;
+    for(int i = 0; i < 4; i++){
+        for(int j = 0; j < 4; j++){
+            float sum = 0.0f;
+            for(int k = 0; k < 4; k++){
+                sum += A.m[i][k] * B.m[k][j];
+            }
+            result.m[i][j] = sum;
+        }
+    }
+    return result;
+}
+
+static CoreMath::Vector4 ScalarMultiply(const CoreMath::Matrix &A, const CoreMath::Vector4 &B) {
+    CoreMath::Vector4 result;
+    for(int i = 0; i < 4; i++){
+        result.f[i] = A.m[i][0] * B.x + A.m[i][1] * B.y + A.m[i][2] * B.z + A.m[i][3] * B.w;
+    }
+    return result;
+}
+
+static NodeScene MakeNodeScene(uint32_t count) {
+    NodeScene scene;
+    scene.parent.resize(count);
+    scene.local.resize(count);
+    scene.world.resize(count);
+    scene.corners.resize(count * 4);
+    for(uint32_t i = 0; i < count; i++) {
+        scene.parent[i] = i == 0 ? 0 : (i - 1) / 4;
+        CoreMath::Matrix translation = CoreMath::CreateTranslationMatrix(
+            CoreMath::Vector2{(float) (i % 97) - 48.0f, (float) (i % 89) - 44.0f});
+        CoreMath::Matrix rotation = CoreMath::CreateZRotationMatrix((float) (i % 360));
+        CoreMath::Matrix scale = CoreMath::CreateScaleMatrix(
+            CoreMath::Vector2{0.9f + (i % 5) * 0.05f, 0.9f + (i % 7) * 0.03f});
+        scene.local[i] = ScalarMultiply(ScalarMultiply(translation, rotation), scale);
+    }
+    return scene;
+}
+
+template <bool Scalar>
+static void UpdateNodes(NodeScene &scene) {
+    const CoreMath::Vector4 quad[4] = {
+        {-0.5f, -0.5f, 0.0f, 1.0f}, {0.5f, -0.5f, 0.0f, 1.0f},
+        {0.5f, 0.5f, 0.0f, 1.0f}, {-0.5f, 0.5f, 0.0f, 1.0f}
+    };
+    uint32_t count = (uint32_t) scene.local.size();
+    scene.world[0] = scene.local[0];
+    for(uint32_t i = 1; i < count; i++) {
+        const CoreMath::Matrix &parent = scene.world[scene.parent[i]];
+        scene.world[i] = Scalar ? ScalarMultiply(parent, scene.local[i]) : CoreMath::Multiply(parent, scene.local[i]);
+    }
+    for(uint32_t i = 0; i < count; i++) {
+        for(uint32_t j = 0; j < 4; j++) {
+            scene.corners[i * 4 + j] = Scalar ?
+                ScalarMultiply(scene.world[i], quad[j]) : CoreMath::Multiply(scene.world[i], quad[j]);
+        }
+    }
+}
+
+static bool NodeTransforms() {
+    bool passed = true;
+    for(uint32_t count : NODE_COUNTS) {
+        NodeScene simd = MakeNodeScene(count);
+        NodeScene scalar = MakeNodeScene(count);
+
+        double simdTime = BestOf([&]() { UpdateNodes<false>(simd); sink = simd.corners.back().x; });
+        double scalarTime = BestOf([&]() { UpdateNodes<true>(scalar); sink = scalar.corners.back().x; });
+
+        float maxError = 0.0f;
+        for(uint32_t i = 0; i < count * 4; i++) {
+            for(uint32_t j = 0; j < 4; j++) {
+                float expected = scalar.corners[i].f[j];
+                float error = fabsf(simd.corners[i].f[j] - expected) / fmaxf(1.0f, fabsf(expected));
+                maxError = fmaxf(maxError, error);
+            }
+        }
+
+        char label[64];
+        snprintf(label, sizeof(label), "%u nodes, scalar", count);
+        Report(label, scalarTime, count);
+        snprintf(label, sizeof(label), "%u nodes, %s", count, MathBackend());
+        Report(label, simdTime, count);
+        printf("  speedup %.2fx, max relative difference %.3g\n", scalarTime / simdTime, maxError);
+        passed = passed && maxError <= NODE_TOLERANCE;
+    }
+    return passed;
+}
+
+
+/*
+ * Narrowphase
+ * Hand computed contacts for the shape pairs that go through different
+ * paths of Collide, then CreatePolygon with point sets that are no valid
+ * polygon, which must fall back to a hull, a capsule or a circle.
+ * */
+static const float NARROWPHASE_TOLERANCE = 1e-4f;
+
+struct NarrowphaseCase {
+    const char *name;
+    CoreGeometry::Shape a;
+    Affine2D transformA;
+    CoreGeometry::Shape b;
+    Affine2D transformB;
+    Vector2 normal;
+    float depth; // deepest point
+    uint32_t pointCount;
+};
+
+static Affine2D Pose(float x, float y, float rotation = 0.0f) {
+    return CoreMath::CreateAffine2D(Vector2{x, y}, Vector2{1.0f, 1.0f}, rotation);
+}
+
+static bool Narrowphase() {
+    const Vector2 slab[4] = {{-2.0f, -1.0f}, {2.0f, -1.0f}, {2.0f, 0.4f}, {-2.0f, 0.4f}};
+    const NarrowphaseCase cases[] = {
+        // centers 1.5 apart, radii 1
+        {"circle-circle",
+            CoreGeometry::CreateCircle(Vector2{0.0f, 0.0f}, 1.0f), Pose(0.0f, 0.0f),
+            CoreGeometry::CreateCircle(Vector2{0.0f, 0.0f}, 1.0f), Pose(1.5f, 0.0f),
+            Vector2{1.0f, 0.0f}, 0.5f, 1},
+        // corner of the 45 degree box at x = sqrt(2), face of the other one at 1.2
+        {"rotated box-box",
+            CoreGeometry::CreateBox(Vector2{1.0f, 1.0f}), Pose(0.0f, 0.0f, 45.0f),
+            CoreGeometry::CreateBox(Vector2{1.0f, 1.0f}), Pose(2.2f, 0.0f),
+            Vector2{1.0f, 0.0f}, sqrtf(2.0f) - 1.2f, 1},
+        // flat capsule bottom at 0.25 over the polygon top at 0.4
+        {"capsule-polygon",
+            CoreGeometry::CreateCapsule(Vector2{-1.0f, 0.0f}, Vector2{1.0f, 0.0f}, 0.25f), Pose(0.0f, 0.5f),
+            CoreGeometry::CreatePolygon(slab, 4), Pose(0.0f, 0.0f),
+            Vector2{0.0f, -1.0f}, 0.15f, 2},
+        // both ends on one point, a circle of radius 0.5 with its bottom at 0.8
+        {"degenerate capsule-box",
+            CoreGeometry::CreateCapsule(Vector2{0.0f, 0.0f}, Vector2{0.0f, 0.0f}, 0.5f), Pose(0.0f, 1.3f),
+            CoreGeometry::CreateBox(Vector2{1.0f, 1.0f}), Pose(0.0f, 0.0f),
+            Vector2{0.0f, -1.0f}, 0.2f, 1},
+    };
+
+    bool passed = true;
+    for(const NarrowphaseCase &c : cases) {
+        CoreGeometry::Manifold manifold = {};
+        bool touching = CoreGeometry::Collide(c.a, c.transformA, c.b, c.transformB, &manifold);
+        float depth = 0.0f;
+        for(uint32_t i = 0; i < manifold.pointCount; i++) {
+            depth = fmaxf(depth, manifold.depths[i]);
+        }
+        bool ok = touching
+            && fabsf(manifold.normal.x - c.normal.x) <= NARROWPHASE_TOLERANCE
+            && fabsf(manifold.normal.y - c.normal.y) <= NARROWPHASE_TOLERANCE
+            && fabsf(depth - c.depth) <= NARROWPHASE_TOLERANCE
+            && manifold.pointCount == c.pointCount;
+        printf("  %-24s normal %.3f %.3f, depth %.4f, %u points%s\n", c.name,
+            manifold.normal.x, manifold.normal.y, depth, manifold.pointCount, ok ? "" : " (wrong)");
+        passed = passed && ok;
+    }
+
+    // ten points on a circle, the four corners of a square with its center, a line
+    Vector2 ring[10];
+    for(uint32_t i = 0; i < 10; i++) {
+        ring[i] = Vector2{cosf(i * 0.6283185f), sinf(i * 0.6283185f)};
+    }
+    const Vector2 square[5] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}, {0.5f, 0.5f}};
+    const Vector2 line[3] = {{0.0f, 0.0f}, {1.0f, 1.0f}, {2.0f, 2.0f}};
+    CoreGeometry::Shape hull = CoreGeometry::CreatePolygon(ring, 10);
+    CoreGeometry::Shape inner = CoreGeometry::CreatePolygon(square, 5);
+    CoreGeometry::Shape flat = CoreGeometry::CreatePolygon(line, 3, 0.1f);
+    CoreGeometry::Shape empty = CoreGeometry::CreatePolygon(nullptr, 0, 0.5f);
+    bool fallbacks = hull.type == CoreGeometry::SHAPE_POLYGON && hull.polygon.count == CoreGeometry::MAX_POLYGON_VERTICES
+        && inner.type == CoreGeometry::SHAPE_POLYGON && inner.polygon.count == 4
+        && flat.type == CoreGeometry::SHAPE_CAPSULE
+        && empty.type == CoreGeometry::SHAPE_CIRCLE;
+    printf("  invalid polygons %s\n", fallbacks ? "replaced" : "kept (wrong)");
+    return passed && fallbacks;
+}
+
+
+/*
+ * Physics scenes
+ * Colliders are owned by bare Empty nodes, no scene graph is involved.
+ * A fixed seed keeps every run and every backend on the same layout.
+ * */
+struct PhysicsScene {
+    vector<GameObject::Empty> owners;
+    vector<CorePhysics::ColliderHandle> handles;
+};
+
+static float RandomRange(uint32_t &state, float min, float max) {
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return min + (max - min) * ((state >> 8) * (1.0f / 16777216.0f));
+}
+
+// Boxes of 4 to 12 units spread so that the density is the same for every count
+static void MakePhysicsScene(PhysicsScene &scene, uint32_t count, float spacing) {
+    uint32_t seed = 0x9E3779B9u;
+    float side = sqrtf((float) count) * spacing;
+    scene.owners.assign(count, GameObject::Empty{});
+    scene.handles.resize(count);
+    for(uint32_t i = 0; i < count; i++) {
+        GameObject::Empty &owner = scene.owners[i];
+        float x = RandomRange(seed, 0.0f, side);
+        float y = RandomRange(seed, 0.0f, side);
+        owner.attribute.type = GameObject::EMPTY;
+        owner.transform.pos = Vector4{x, y, 0.0f, 0.0f};
+        owner.transform.World.m13 = x;
+        owner.transform.World.m23 = y;
+        Vector2 halfExtents = {RandomRange(seed, 2.0f, 6.0f), RandomRange(seed, 2.0f, 6.0f)};
+        scene.handles[i] = CorePhysics::CreateCollider(&owner, CoreGeometry::CreateBox(halfExtents));
+    }
+}
+
+// FNV-1a over the positions and velocities, equal hashes mean an identical simulation
+static uint64_t StateHash(const CorePhysics::World *world) {
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&](const vector<Vector2> &values) {
+        const uint8_t *bytes = (const uint8_t*) values.data();
+        for(size_t i = 0; i < values.size() * sizeof(Vector2); i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    mix(world->positions);
+    mix(world->velocities);
+    return hash;
+}
+
+
+/*
+ * Broadphase pairs
+ * Cost of a step with the grid and the tree broadphase against an all pairs
+ * test of the same bounds, for a growing collider count. Nothing moves and
+ * the solver is off so the grid pairs must match the brute force pairs,
+ * the tree pairs fat bounds and reports at least as many.
+ * */
+static const uint32_t PAIR_COUNTS[] = {1000, 4000, 16000};
+
+static uint32_t BruteForcePairs(const CorePhysics::World *world) {
+    uint32_t pairs = 0;
+    uint32_t count = (uint32_t) world->bounds.size();
+    for(uint32_t a = 0; a < count; a++) {
+        const CoreGeometry::BoundingRect &ba = world->bounds[a];
+        for(uint32_t b = a + 1; b < count; b++) {
+            const CoreGeometry::BoundingRect &bb = world->bounds[b];
+            if(ba.bound.minX <= bb.bound.maxX && ba.bound.maxX >= bb.bound.minX &&
+               ba.bound.minY <= bb.bound.maxY && ba.bound.maxY >= bb.bound.minY) {
+                pairs++;
+            }
+        }
+    }
+    return pairs;
+}
+
+static bool BroadphasePairs() {
+    bool passed = true;
+    for(uint32_t count : PAIR_COUNTS) {
+        CorePhysics::WorldMake();
+        CorePhysics::SetSleepThresholds(0.0f, 0.0f, false);
+        CorePhysics::SetSolverIterations(0);
+        CorePhysics::SetBroadphase(CorePhysics::BROADPHASE_GRID);
+        CorePhysics::SetBroadphaseCellSize(16.0f);
+        PhysicsScene scene;
+        MakePhysicsScene(scene, count, 24.0f);
+        CorePhysics::World *world = CoreGlobals::physicsWorld;
+        double fixedStep = world->fixedStep;
+
+        double grid = BestOf([&]() { CorePhysics::Step(fixedStep); });
+        uint32_t gridPairs = (uint32_t) world->pairs.size();
+        CorePhysics::SetBroadphase(CorePhysics::BROADPHASE_TREE);
+        CorePhysics::Step(fixedStep);
+        double tree = BestOf([&]() { CorePhysics::Step(fixedStep); });
+        uint32_t treePairs = (uint32_t) world->pairs.size();
+        uint32_t brutePairs = 0;
+        double brute = BestOf([&]() { brutePairs = BruteForcePairs(world); });
+
+        char label[64];
+        snprintf(label, sizeof(label), "%u colliders, step with grid", count);
+        Report(label, grid, count);
+        snprintf(label, sizeof(label), "%u colliders, step with tree", count);
+        Report(label, tree, count);
+        snprintf(label, sizeof(label), "%u colliders, brute force pairs", count);
+        Report(label, brute, count);
+        printf("  pairs grid %u, tree %u, brute force %u\n", gridPairs, treePairs, brutePairs);
+        passed = passed && gridPairs == brutePairs && treePairs >= brutePairs;
+        CorePhysics::WorldDestroy();
+    }
+    return passed;
+}
+
+
+/*
+ * Step scaling
+ * The same 10k body scene stepped with a growing number of threads,
+ * one thread being the main thread without a job system. Batches do not
+ * depend on the worker count so every run must end in the same state.
+ * */
+static const uint32_t SCALING_BODIES = 10000;
+static const uint32_t SCALING_STEPS = 60;
+static const uint32_t SCALING_THREADS[] = {1, 2, 4, 8};
+
+static bool StepScaling() {
+    double serial = 0.0;
+    uint64_t expected = 0;
+    bool passed = true;
+    for(uint32_t threads : SCALING_THREADS) {
+        if(threads > 1) {
+            CoreJobs::JobsMake(threads - 1);
+        }
+        CorePhysics::WorldMake();
+        CorePhysics::SetGravity(Vector2{0.0f, -98.0f});
+        CorePhysics::SetSleepThresholds(0.0f, 0.0f, false);
+        PhysicsScene scene;
+        MakePhysicsScene(scene, SCALING_BODIES, 10.0f);
+        uint32_t seed = 0x2545F491u;
+        for(CorePhysics::ColliderHandle handle : scene.handles) {
+            CorePhysics::SetVelocity(handle, Vector2{RandomRange(seed, -40.0f, 40.0f), RandomRange(seed, -40.0f, 40.0f)});
+        }
+        CorePhysics::World *world = CoreGlobals::physicsWorld;
+        double fixedStep = world->fixedStep;
+
+        double start = Now();
+        for(uint32_t i = 0; i < SCALING_STEPS; i++) {
+            CorePhysics::Step(fixedStep);
+        }
+        double elapsed = Now() - start;
+        uint64_t hash = StateHash(world);
+
+        if(threads == 1) {
+            serial = elapsed;
+            expected = hash;
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "%u threads, %u steps", threads, SCALING_STEPS);
+        Report(label, elapsed, SCALING_STEPS);
+        printf("  speedup %.2fx, state hash %016llx\n", serial / elapsed, (unsigned long long) hash);
+        passed = passed && hash == expected;
+
+        CorePhysics::WorldDestroy();
+        if(threads > 1) {
+            CoreJobs::JobsDestroy();
+        }
+    }
+    return passed;
+}
+
+
+/*
+ * Rollback
+ * Save, restore and a restore followed by an 8 step resimulation on 2k
+ * bodies, the usual cost of one rollback frame. The resimulated state
+ * must match the state the live steps reached, and a snapshot must be
+ * rejected once a collider was created after it.
+ * */
+static const uint32_t ROLLBACK_BODIES = 2000;
+static const uint32_t ROLLBACK_FRAMES = 8;
+
+static bool Rollback() {
+    CorePhysics::WorldMake();
+    CorePhysics::SetGravity(Vector2{0.0f, -98.0f});
+    CorePhysics::SetSleepThresholds(0.0f, 0.0f, false);
+    PhysicsScene scene;
+    MakePhysicsScene(scene, ROLLBACK_BODIES, 10.0f);
+    CorePhysics::World *world = CoreGlobals::physicsWorld;
+    double fixedStep = world->fixedStep;
+    for(uint32_t i = 0; i < 30; i++) {
+        CorePhysics::Step(fixedStep);
+    }
+
+    vector<uint8_t> snapshot;
+    CorePhysics::SaveSnapshot(snapshot);
+    for(uint32_t i = 0; i < ROLLBACK_FRAMES; i++) {
+        CorePhysics::Step(fixedStep);
+    }
+    uint64_t expected = StateHash(world);
+
+    vector<uint8_t> buffer;
+    double save = BestOf([&]() { CorePhysics::SaveSnapshot(buffer); });
+    bool restored = true;
+    double restore = BestOf([&]() {
+        restored = restored && CorePhysics::RestoreSnapshot(snapshot.data(), snapshot.size());
+    });
+    double resimulate = BestOf([&]() {
+        restored = restored && CorePhysics::RestoreSnapshot(snapshot.data(), snapshot.size());
+        CorePhysics::Resimulate(ROLLBACK_FRAMES);
+    });
+    uint64_t hash = StateHash(world);
+
+    Report("save", save, ROLLBACK_BODIES);
+    Report("restore", restore, ROLLBACK_BODIES);
+    Report("restore and resimulate 8 steps", resimulate, ROLLBACK_BODIES);
+    printf("  snapshot %zu bytes, state hash %016llx, expected %016llx\n",
+        snapshot.size(), (unsigned long long) hash, (unsigned long long) expected);
+
+    CorePhysics::CreateCollider(nullptr, CoreGeometry::CreateCircle(Vector2{0.0f, 0.0f}, 1.0f));
+    bool rejected = !CorePhysics::RestoreSnapshot(snapshot.data(), snapshot.size());
+    printf("  restore after a new collider %s\n", rejected ? "rejected" : "accepted");
+
+    CorePhysics::WorldDestroy();
+    return restored && rejected && hash == expected;
+}
+
+
+/*
+ * Static level
+ * A 50k node level of 500 groups of 99 sprites, with only part of the
+ * sprites moving every frame. Only the moved sprites are recomputed and the
+ * update pass cost must follow the moving count, not the level size: 0 and
+ * 50 movers must cost a small fraction of moving everything. A moved group
+ * recomputes its sprites, and every world transform must match a full
+ * recompute at the end.
+ * Runs on the headless backend (Graphics_null.cpp, FontLoader_null.cpp).
+ * */
+static const uint32_t LEVEL_GROUPS = 500;
+static const uint32_t LEVEL_GROUP_SPRITES = 99;
+static const uint32_t LEVEL_FRAMES = 10;
+static const uint32_t LEVEL_MOVING[] = {0, 50, 500, 5000, 49500};
+static const double LEVEL_STATIC_FRACTION = 0.1; // of the all moving cost
+static const float LEVEL_TOLERANCE = 1e-3f;
+
+static bool StaticLevel() {
+    GameResource::Texture texture;
+    texture.dimension = Vector2{16.0f, 16.0f};
+    GameResource::Material material;
+    material.mainTexture = &texture;
+    material.shader = nullptr;
+
+    Camera *camera = GameObject::CreateCamera("bench-camera", "Camera", Vector2{0.0f, 0.0f});
+    Empty *root = GameObject::CreateEmptyObject("bench-root", "Empty", Vector2{0.0f, 0.0f}, Vector2{1.0f, 1.0f}, 0.0f);
+    vector<Node2D*> sprites;
+    for(uint32_t g = 0; g < LEVEL_GROUPS; g++) {
+        Vector2 groupPosition = {(float) (g % 25) * 200.0f - 2500.0f, (float) (g / 25) * 200.0f - 2000.0f};
+        Empty *group = GameObject::CreateEmptyObject("bench-group", "Empty", groupPosition, Vector2{1.0f, 1.0f}, 0.0f);
+        SceneGraph::AttachTo((Node2D*) root, (Node2D*) group);
+        for(uint32_t i = 0; i < LEVEL_GROUP_SPRITES; i++) {
+            Vector2 position = {(float) (i % 11) * 18.0f - 90.0f, (float) (i / 11) * 18.0f - 80.0f};
+            Sprite *sprite = GameObject::CreateSprite("bench-sprite", "Sprite", &material, position, Vector2{1.0f, 1.0f}, 0.0f);
+            SceneGraph::AttachTo((Node2D*) group, (Node2D*) sprite);
+            sprites.push_back((Node2D*) sprite);
+        }
+    }
+    SceneGraph::AttachTo((Node2D*) root, (Node2D*) camera);
+    SceneGraph::Scene *scene = SceneGraph::CreateScene("bench-level", camera, (Node2D*) root);
+    if(!scene) return false;
+    SceneGraph::UpdatePass(scene, 60, 1.0 / 60.0);
+    SceneGraph::DrawPass(scene);
+    printf("  %zu nodes, first pass %u transforms\n",
+        scene->hierarchy.nodes.size(), SceneGraph::GetUpdatedTransformCount(scene));
+
+    bool passed = true;
+    const uint32_t cases = sizeof(LEVEL_MOVING) / sizeof(LEVEL_MOVING[0]);
+    double frameTimes[cases];
+    for(uint32_t c = 0; c < cases; c++) {
+        uint32_t moving = LEVEL_MOVING[c];
+        uint32_t stride = moving ? (uint32_t) sprites.size() / moving : 0;
+        double elapsed = 0.0;
+        for(uint32_t frame = 0; frame < LEVEL_FRAMES; frame++) {
+            // back and forth so the level stays in place
+            Vector2 delta = frame % 2 ? Vector2{-1.0f, 0.5f} : Vector2{1.0f, -0.5f};
+            for(uint32_t i = 0; i < moving; i++) {
+                GameObject::Translate(sprites[i * stride], delta);
+            }
+            double start = Now();
+            SceneGraph::UpdatePass(scene, 60, 1.0 / 60.0);
+            elapsed += Now() - start;
+            passed = passed && SceneGraph::GetUpdatedTransformCount(scene) == moving;
+            SceneGraph::DrawPass(scene);
+        }
+
+        frameTimes[c] = elapsed / LEVEL_FRAMES;
+        char label[64];
+        snprintf(label, sizeof(label), "%u moving, update pass per frame", moving);
+        Report(label, frameTimes[c], (uint32_t) scene->hierarchy.nodes.size());
+    }
+    double all = frameTimes[cases - 1];
+    printf("  0 moving at %.1f%%, 50 moving at %.1f%% of all moving\n",
+        100.0 * frameTimes[0] / all, 100.0 * frameTimes[1] / all);
+    passed = passed && frameTimes[0] <= LEVEL_STATIC_FRACTION * all && frameTimes[1] <= LEVEL_STATIC_FRACTION * all;
+
+    Node2D *group = root->attribute.children[0];
+    GameObject::Translate(group, Vector2{5.0f, 5.0f});
+    SceneGraph::UpdatePass(scene, 60, 1.0 / 60.0);
+    SceneGraph::DrawPass(scene);
+    uint32_t groupUpdated = SceneGraph::GetUpdatedTransformCount(scene);
+    printf("  moved group, %u transforms\n", groupUpdated);
+    passed = passed && groupUpdated == LEVEL_GROUP_SPRITES + 1;
+
+    float maxError = 0.0f;
+    for(Node2D *node : scene->hierarchy.nodes) {
+        Transform2D &transform = reinterpret_cast<Empty*>(node)->transform;
+        Affine2D world = CoreMath::CreateAffine2D(transform.pos.xy, transform.scale, transform.rotation);
+        if(node->parent) {
+            world = CoreMath::Multiply(reinterpret_cast<Empty*>(node->parent)->transform.World, world);
+        }
+        for(uint32_t i = 0; i < 6; i++) {
+            maxError = fmaxf(maxError, fabsf(world.f[i] - transform.World.f[i]));
+        }
+    }
+    printf("  max world transform difference %.3g\n", maxError);
+    return passed && maxError <= LEVEL_TOLERANCE;
+}
+
+
+static const Bench benches[] = {
+    {"sincos-accuracy", SinCosAccuracy},
+    {"sincos-speed", SinCosSpeed},
+    {"node-transforms", NodeTransforms},
+    {"narrowphase", Narrowphase},
+    {"broadphase-pairs", BroadphasePairs},
+    {"step-scaling", StepScaling},
+    {"rollback", Rollback},
+    {"static-level", StaticLevel},
+};
+
+// Runs every case, or only those whose name contains argv[1].
+// Exits non zero when any check failed so that it can gate a build.
+int main(int argc, char* argv[]) {
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    printf("CoreMath backend: %s\n", MathBackend());
+
+    uint32_t failed = 0;
+    for(const Bench &bench : benches) {
+        if(filter && !strstr(bench.name, filter)) {
+            continue;
+        }
+        printf("\n%s\n", bench.name);
+        if(!bench.run()) {
+            printf("  FAILED\n");
+            failed++;
+        }
+    }
+
+    printf("\n%u failed\n", failed);
+    return failed ? 1 : 0;
+}
@@ -1,4 +1,5 @@
 #include <EngineCore.h>
+#include <EnginePlatformAPI.h>
 #include <cstdint>
 
 using namespace GameObject;
@@ -26,21 +27,19 @@ bool EngineCore::Start(){
     GameResource::Font* courier = GameResource::CreateFontResource("C:\\Windows\\Fonts\\consola.ttf", 36);
     DebugDraw::CreateText("", "log", DebugDraw::TextAlignment::ALIGN_LEFT, Vector2{10.0f, 10.0f});
 
+    CoreJobs::JobsMake();
     CorePhysics::WorldMake();
+    if(EnginePlatformAPI::GetTargetFPS() > 0) {
+        CorePhysics::SetFixedStep(1.0 / EnginePlatformAPI::GetTargetFPS());
+    }
 
     Sprite *player = reinterpret_cast<Sprite*>(CoreGlobals::_nodes["Player"][0]);
     Sprite *box = reinterpret_cast<Sprite*>(CoreGlobals::_nodes["Box"][0]);
     if(player && box) {
-        CorePhysics::BoxCollider *playerCollider = CorePhysics::CreateBoxCollider((GameObject::Empty*) player, player->geometry.AABB);
-        CorePhysics::BoxCollider *boxCollider = CorePhysics::CreateBoxCollider((GameObject::Empty*) box, box->geometry.AABB);
-        if(playerCollider && boxCollider) {
-            player->collider = playerCollider;
-            box->collider = boxCollider;
-            CorePhysics::RegisterCollider(player->collider);
-            CorePhysics::RegisterCollider(box->collider);
-            Debug::Logger("Registering Collider to ", player->attribute.name);
-            Debug::Logger("Registering Collider to ", box->attribute.name);
-        }
+        player->collider = CorePhysics::CreateBoxCollider((GameObject::Empty*) player, player->geometry.AABB);
+        box->collider = CorePhysics::CreateBoxCollider((GameObject::Empty*) box, box->geometry.AABB);
+        Debug::Logger("Registering Collider to ", player->attribute.name);
+        Debug::Logger("Registering Collider to ", box->attribute.name);
     }
 
     
@@ -67,10 +66,14 @@ bool EngineCore::Start(){
 
 void EngineCore::UpdateAndRender(uint32_t fps, double deltaTime){
     Game::Update(fps, deltaTime);
-    SceneGraph::UpdatePass(CoreGlobals::activeScene, fps, deltaTime);
+    // physics writes owner positions, the update pass turns them into world transforms
     CorePhysics::Step(deltaTime);
+    CorePhysics::DispatchContactEvents();
+    // interpolates physics owners between the behaviors and the transform propagation
+    SceneGraph::UpdatePass(CoreGlobals::activeScene, fps, deltaTime);
     SceneGraph::DrawPass(CoreGlobals::activeScene);
     DebugDraw::DrawPass();
+    CorePhysics::RestorePass();
 }
 
 
@@ -113,18 +116,16 @@ void EngineCore::Shutdown() {
     CoreGlobals::_fonts.clear();
     Debug::Logger("EngineCore:: Font resource are cleared");
 
-    for(auto &pair : CoreGlobals::nodes) {
-        auto node = pair.second;
-        if(node->type == GameObject::Type::SPRITE) {
-            GameObject::FreeSpriteGeometryResource((GameObject::Sprite **) &pair.second);
-        }
-        delete pair.second;
+    // before WorldDestroy, nodes destroy their colliders
+    while(!CoreGlobals::nodes.nodes.empty()) {
+        GameObject::DestroyNode(CoreGlobals::nodes.nodes.back());
     }
-    CoreGlobals::nodes.clear();
+    CoreGlobals::nodes = GameObject::NodeRegistry();
     CoreGlobals::_nodes.clear();
     Debug::Logger("EngineCore:: object nodes are cleared");
 
     CorePhysics::WorldDestroy();
+    CoreJobs::JobsDestroy();
     // SceneGraph::Shutdown();
 }
 
@@ -16,7 +16,25 @@ bool Engine::RegisterTypeFactory(std::string typeName, FactoryFunctionType facto
 
 
 void Engine::SetGameFPS(uint32_t fps) {
+    if(fps == 0) {
+        Debug::Logger("SetGameFPS: fps must be positive");
+        return;
+    }
     EnginePlatformAPI::SetGameFPS(fps);
+    if(CoreGlobals::physicsWorld) CorePhysics::SetFixedStep(1.0 / fps);
+}
+
+
+void Engine::SetCollisionFilter(Node2D *node, uint32_t categories, uint32_t mask) {
+    if(node->type != GameObject::Type::SPRITE && node->type != GameObject::Type::EMPTY) {
+        Debug::Logger("SetCollisionFilter: node has no collider ", node->name);
+        return;
+    }
+    GameObject::Empty *e = reinterpret_cast<GameObject::Empty*>(node);
+    e->collisionFilter = CorePhysics::CollisionFilter{categories, mask};
+    if(CoreGlobals::physicsWorld && CorePhysics::IsValidCollider(e->collider)) {
+        CorePhysics::SetCollisionFilter(e->collider, e->collisionFilter);
+    }
 }
 
 
@@ -0,0 +1,483 @@
+#include <core/DSA.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace CoreDSA;
+using CoreGeometry::BoundingRect;
+
+
+/*
+ * Bounds helpers
+ * */
+
+
+static inline BoundingRect Union(const BoundingRect &a, const BoundingRect &b) {
+    BoundingRect r;
+    r.bound = {
+        std::min(a.bound.minX, b.bound.minX),
+        std::min(a.bound.minY, b.bound.minY),
+        std::max(a.bound.maxX, b.bound.maxX),
+        std::max(a.bound.maxY, b.bound.maxY)
+    };
+    return r;
+}
+
+
+static inline float Perimeter(const BoundingRect &a) {
+    return 2.0f * ((a.bound.maxX - a.bound.minX) + (a.bound.maxY - a.bound.minY));
+}
+
+
+static inline bool Overlaps(const BoundingRect &a, const BoundingRect &b) {
+    return a.bound.minX <= b.bound.maxX && a.bound.maxX >= b.bound.minX &&
+           a.bound.minY <= b.bound.maxY && a.bound.maxY >= b.bound.minY;
+}
+
+
+static inline bool Contains(const BoundingRect &outer, const BoundingRect &inner) {
+    return outer.bound.minX <= inner.bound.minX && outer.bound.minY <= inner.bound.minY &&
+           outer.bound.maxX >= inner.bound.maxX && outer.bound.maxY >= inner.bound.maxY;
+}
+
+
+static inline bool IsLeaf(const TreeNode &node) {
+    return node.child1 == NULL_NODE;
+}
+
+
+/*
+ * Node pool
+ * */
+
+
+static int32_t AllocateNode(DynamicTree *tree) {
+    int32_t index;
+    if(tree->freeList == NULL_NODE) {
+        index = (int32_t) tree->nodes.size();
+        tree->nodes.push_back(TreeNode{});
+    }else{
+        index = tree->freeList;
+        tree->freeList = tree->nodes[index].parent;
+    }
+    TreeNode &node = tree->nodes[index];
+    node.parent = NULL_NODE;
+    node.child1 = NULL_NODE;
+    node.child2 = NULL_NODE;
+    node.height = 0;
+    node.userData = 0;
+    node.moved = false;
+    return index;
+}
+
+
+static void FreeNode(DynamicTree *tree, int32_t index) {
+    tree->nodes[index].parent = tree->freeList;
+    tree->nodes[index].height = -1;
+    tree->freeList = index;
+}
+
+
+/*
+ * Balancing
+ * Single left/right rotation of the node at index a when the height of its
+ * children differ by more than one, returns the new root of the subtree.
+ * */
+static int32_t Balance(DynamicTree *tree, int32_t iA) {
+    std::vector<TreeNode> &nodes = tree->nodes;
+    TreeNode &A = nodes[iA];
+    if(IsLeaf(A) || A.height < 2) return iA;
+
+    int32_t iB = A.child1;
+    int32_t iC = A.child2;
+    int32_t balance = nodes[iC].height - nodes[iB].height;
+
+    // rotate C up
+    if(balance > 1) {
+        TreeNode &C = nodes[iC];
+        int32_t iF = C.child1;
+        int32_t iG = C.child2;
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+        if(C.parent != NULL_NODE) {
+            if(nodes[C.parent].child1 == iA) nodes[C.parent].child1 = iC;
+            else nodes[C.parent].child2 = iC;
+        }else{
+            tree->root = iC;
+        }
+
+        if(nodes[iF].height > nodes[iG].height) {
+            C.child2 = iF;
+            A.child2 = iG;
+            nodes[iG].parent = iA;
+        }else{
+            C.child2 = iG;
+            A.child2 = iF;
+            nodes[iF].parent = iA;
+        }
+        A.aabb = Union(nodes[iB].aabb, nodes[A.child2].aabb);
+        C.aabb = Union(A.aabb, nodes[C.child2].aabb);
+        A.height = 1 + std::max(nodes[iB].height, nodes[A.child2].height);
+        C.height = 1 + std::max(A.height, nodes[C.child2].height);
+        return iC;
+    }
+
+    // rotate B up
+    if(balance < -1) {
+        TreeNode &B = nodes[iB];
+        int32_t iD = B.child1;
+        int32_t iE = B.child2;
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+        if(B.parent != NULL_NODE) {
+            if(nodes[B.parent].child1 == iA) nodes[B.parent].child1 = iB;
+            else nodes[B.parent].child2 = iB;
+        }else{
+            tree->root = iB;
+        }
+
+        if(nodes[iD].height > nodes[iE].height) {
+            B.child2 = iD;
+            A.child1 = iE;
+            nodes[iE].parent = iA;
+        }else{
+            B.child2 = iE;
+            A.child1 = iD;
+            nodes[iD].parent = iA;
+        }
+        A.aabb = Union(nodes[A.child1].aabb, nodes[iC].aabb);
+        B.aabb = Union(A.aabb, nodes[B.child2].aabb);
+        A.height = 1 + std::max(nodes[A.child1].height, nodes[iC].height);
+        B.height = 1 + std::max(A.height, nodes[B.child2].height);
+        return iB;
+    }
+
+    return iA;
+}
+
+
+// Refits bounds and heights from index up to the root, rotating on the way
+static void Refit(DynamicTree *tree, int32_t index) {
+    std::vector<TreeNode> &nodes = tree->nodes;
+    while(index != NULL_NODE) {
+        index = Balance(tree, index);
+        TreeNode &node = nodes[index];
+        node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+        node.aabb = Union(nodes[node.child1].aabb, nodes[node.child2].aabb);
+        index = node.parent;
+    }
+}
+
+
+/*
+ * Insert picks the sibling with the surface area heuristic,
+ * perimeter is the 2D equivalent of the surface area.
+ * */
+static void InsertLeaf(DynamicTree *tree, int32_t leaf) {
+    std::vector<TreeNode> &nodes = tree->nodes;
+    if(tree->root == NULL_NODE) {
+        tree->root = leaf;
+        nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    BoundingRect leafAABB = nodes[leaf].aabb;
+    int32_t index = tree->root;
+    while(!IsLeaf(nodes[index])) {
+        const TreeNode &node = nodes[index];
+        float area = Perimeter(node.aabb);
+        float combinedArea = Perimeter(Union(node.aabb, leafAABB));
+
+        // cost of making a new parent for this node and the leaf
+        float cost = 2.0f * combinedArea;
+        // minimum cost of pushing the leaf further down
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float costs[2];
+        int32_t children[2] = {node.child1, node.child2};
+        for(int c = 0; c < 2; c++) {
+            const TreeNode &child = nodes[children[c]];
+            float childCombined = Perimeter(Union(leafAABB, child.aabb));
+            costs[c] = IsLeaf(child)
+                ? childCombined + inheritanceCost
+                : childCombined - Perimeter(child.aabb) + inheritanceCost;
+        }
+
+        if(cost < costs[0] && cost < costs[1]) break;
+        index = costs[0] < costs[1] ? children[0] : children[1];
+    }
+
+    int32_t sibling = index;
+    int32_t oldParent = nodes[sibling].parent;
+    int32_t newParent = AllocateNode(tree); // may grow the pool
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].aabb = Union(leafAABB, nodes[sibling].aabb);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if(oldParent != NULL_NODE) {
+        if(nodes[oldParent].child1 == sibling) nodes[oldParent].child1 = newParent;
+        else nodes[oldParent].child2 = newParent;
+    }else{
+        tree->root = newParent;
+    }
+
+    Refit(tree, nodes[leaf].parent);
+}
+
+
+static void RemoveLeaf(DynamicTree *tree, int32_t leaf) {
+    std::vector<TreeNode> &nodes = tree->nodes;
+    if(leaf == tree->root) {
+        tree->root = NULL_NODE;
+        return;
+    }
+
+    int32_t parent = nodes[leaf].parent;
+    int32_t grandParent = nodes[parent].parent;
+    int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if(grandParent != NULL_NODE) {
+        if(nodes[grandParent].child1 == parent) nodes[grandParent].child1 = sibling;
+        else nodes[grandParent].child2 = sibling;
+        nodes[sibling].parent = grandParent;
+        FreeNode(tree, parent);
+        Refit(tree, grandParent);
+    }else{
+        tree->root = sibling;
+        nodes[sibling].parent = NULL_NODE;
+        FreeNode(tree, parent);
+    }
+}
+
+
+static BoundingRect Fatten(const BoundingRect &aabb, float margin) {
+    BoundingRect r;
+    r.bound = {
+        aabb.bound.minX - margin,
+        aabb.bound.minY - margin,
+        aabb.bound.maxX + margin,
+        aabb.bound.maxY + margin
+    };
+    return r;
+}
+
+
+/*
+ * Proxies
+ * */
+
+
+int32_t CoreDSA::CreateProxy(DynamicTree *tree, const BoundingRect &aabb, uint32_t userData) {
+    int32_t proxy = AllocateNode(tree);
+    TreeNode &node = tree->nodes[proxy];
+    node.aabb = Fatten(aabb, tree->fatMargin);
+    node.userData = userData;
+    node.moved = true;
+    InsertLeaf(tree, proxy);
+    tree->moveBuffer.push_back(proxy);
+    return proxy;
+}
+
+
+void CoreDSA::DestroyProxy(DynamicTree *tree, int32_t proxy) {
+    RemoveLeaf(tree, proxy);
+    if(tree->nodes[proxy].moved) {
+        auto &buffer = tree->moveBuffer;
+        buffer.erase(std::remove(buffer.begin(), buffer.end(), proxy), buffer.end());
+    }
+    FreeNode(tree, proxy);
+}
+
+
+bool CoreDSA::MoveProxy(
+    DynamicTree *tree,
+    int32_t proxy,
+    const BoundingRect &aabb,
+    const Vector2 &displacement
+) {
+    // predict the motion so a moving leaf is not reinserted every step
+    BoundingRect fat = Fatten(aabb, tree->fatMargin);
+    float dx = tree->displacementMultiplier * displacement.x;
+    float dy = tree->displacementMultiplier * displacement.y;
+    if(dx < 0.0f) fat.bound.minX += dx; else fat.bound.maxX += dx;
+    if(dy < 0.0f) fat.bound.minY += dy; else fat.bound.maxY += dy;
+
+    // still inside, kept unless it was stretched for a motion that has stopped
+    const TreeNode &node = tree->nodes[proxy];
+    if(Contains(node.aabb, aabb) && Perimeter(node.aabb) <= tree->refitRatio * Perimeter(fat)) return false;
+
+    RemoveLeaf(tree, proxy);
+    tree->nodes[proxy].aabb = fat;
+    InsertLeaf(tree, proxy);
+    if(!tree->nodes[proxy].moved) {
+        tree->nodes[proxy].moved = true;
+        tree->moveBuffer.push_back(proxy);
+    }
+    return true;
+}
+
+
+void CoreDSA::TouchProxy(DynamicTree *tree, int32_t proxy) {
+    if(tree->nodes[proxy].moved) return;
+    tree->nodes[proxy].moved = true;
+    tree->moveBuffer.push_back(proxy);
+}
+
+
+void CoreDSA::ClearTree(DynamicTree *tree) {
+    tree->nodes.clear();
+    tree->moveBuffer.clear();
+    tree->root = NULL_NODE;
+    tree->freeList = NULL_NODE;
+}
+
+
+int32_t CoreDSA::GetHeight(const DynamicTree &tree) {
+    return tree.root == NULL_NODE ? 0 : tree.nodes[tree.root].height;
+}
+
+
+/*
+ * Traversal
+ * Iterative, the tree is balanced so the stack stays far below
+ * TREE_STACK_SIZE for any realistic proxy count. A deeper tree
+ * spills to the heap instead of skipping children.
+ * */
+
+
+struct TraversalStack {
+    int32_t nodes[TREE_STACK_SIZE];
+    std::vector<int32_t> spill;
+    int32_t count = 0;
+};
+
+
+static inline void Push(TraversalStack &stack, int32_t index) {
+    if(stack.count < TREE_STACK_SIZE) stack.nodes[stack.count] = index;
+    else stack.spill.push_back(index);
+    stack.count++;
+}
+
+
+static inline int32_t Pop(TraversalStack &stack) {
+    stack.count--;
+    if(stack.count < TREE_STACK_SIZE) return stack.nodes[stack.count];
+    int32_t index = stack.spill.back();
+    stack.spill.pop_back();
+    return index;
+}
+
+
+void CoreDSA::Query(const DynamicTree &tree, const BoundingRect &aabb, TreeQueryCallback callback, void *context) {
+    if(tree.root == NULL_NODE) return;
+    TraversalStack stack;
+    Push(stack, tree.root);
+    while(stack.count > 0) {
+        int32_t index = Pop(stack);
+        const TreeNode &node = tree.nodes[index];
+        if(!Overlaps(node.aabb, aabb)) continue;
+        if(IsLeaf(node)) {
+            if(!callback(index, context)) return;
+        }else{
+            Push(stack, node.child1);
+            Push(stack, node.child2);
+        }
+    }
+}
+
+
+// Slab test, returns the entry distance or a negative value on a miss
+static float RayEntry(const BoundingRect &aabb, const Vector2 &origin, const Vector2 &inverse, float maxDistance) {
+    float t1 = (aabb.bound.minX - origin.x) * inverse.x;
+    float t2 = (aabb.bound.maxX - origin.x) * inverse.x;
+    float t3 = (aabb.bound.minY - origin.y) * inverse.y;
+    float t4 = (aabb.bound.maxY - origin.y) * inverse.y;
+    float tmin = std::max(std::min(t1, t2), std::min(t3, t4));
+    float tmax = std::min(std::max(t1, t2), std::max(t3, t4));
+    if(tmax < 0.0f || tmin > tmax || tmin > maxDistance) return -1.0f;
+    return std::max(tmin, 0.0f);
+}
+
+
+void CoreDSA::Raycast(
+    const DynamicTree &tree,
+    const Vector2 &origin,
+    const Vector2 &direction,
+    float maxDistance,
+    TreeRaycastCallback callback,
+    void *context
+) {
+    if(tree.root == NULL_NODE) return;
+    // inf on an axis parallel ray keeps the slab test valid
+    Vector2 inverse = {
+        direction.x != 0.0f ? 1.0f / direction.x : FLT_MAX,
+        direction.y != 0.0f ? 1.0f / direction.y : FLT_MAX
+    };
+    TraversalStack stack;
+    Push(stack, tree.root);
+    while(stack.count > 0) {
+        int32_t index = Pop(stack);
+        const TreeNode &node = tree.nodes[index];
+        if(RayEntry(node.aabb, origin, inverse, maxDistance) < 0.0f) continue;
+        if(IsLeaf(node)) {
+            maxDistance = callback(index, origin, direction, maxDistance, context);
+            if(maxDistance <= 0.0f) return;
+        }else{
+            Push(stack, node.child1);
+            Push(stack, node.child2);
+        }
+    }
+}
+
+
+struct PairQueryContext {
+    const DynamicTree *tree;
+    int32_t proxy;
+    std::vector<ProxyPair> *pairs;
+};
+
+
+static bool CollectPair(int32_t other, void *context) {
+    PairQueryContext *ctx = (PairQueryContext*) context;
+    if(other == ctx->proxy) return true;
+    const TreeNode &otherNode = ctx->tree->nodes[other];
+    // both moved, the one with the lower proxy id reports the pair
+    if(otherNode.moved && other < ctx->proxy) return true;
+    uint32_t a = ctx->tree->nodes[ctx->proxy].userData;
+    uint32_t b = otherNode.userData;
+    ctx->pairs->push_back(a < b ? ProxyPair{a, b} : ProxyPair{b, a});
+    return true;
+}
+
+
+void CoreDSA::QueryPairs(const DynamicTree &tree, const int32_t *proxies, uint32_t count, std::vector<ProxyPair> &pairs) {
+    PairQueryContext ctx;
+    ctx.tree = &tree;
+    ctx.pairs = &pairs;
+    for(uint32_t i = 0; i < count; i++) {
+        ctx.proxy = proxies[i];
+        Query(tree, tree.nodes[ctx.proxy].aabb, CollectPair, &ctx);
+    }
+}
+
+
+void CoreDSA::ClearMoveBuffer(DynamicTree *tree) {
+    for(int32_t proxy : tree->moveBuffer) {
+        tree->nodes[proxy].moved = false;
+    }
+    tree->moveBuffer.clear();
+}
+
+
+void CoreDSA::QueryPairs(DynamicTree *tree, std::vector<ProxyPair> &pairs) {
+    QueryPairs(*tree, tree->moveBuffer.data(), (uint32_t) tree->moveBuffer.size(), pairs);
+    ClearMoveBuffer(tree);
+}
@@ -10,8 +10,6 @@
 #include <utils/rapidjson/error/en.h>
 #include <utils/Debug.h>
 #include <any>
-#include <stack>
-#include <set>
 #include <cassert>
 
 using namespace CoreGlobals;
@@ -49,6 +47,8 @@ bool GameLoader::LoadLevelFromFile(std::string filePath){
     rapidjson::Value &nodes         = DOM["nodes"];
     rapidjson::Value &node_details  = DOM["node_details"];
     assert(nodes.Size() == node_details.Size());
+    // level file ids only resolve links while loading, nodes are identified by handles
+    std::unordered_map<std::string, GameObject::Node2D*> loadedNodes;
 
     Debug::Logger("========== Loading Game Objects ===========");
     for(auto it = node_details.Begin(); it != node_details.End(); ++it) {
@@ -112,8 +112,24 @@ bool GameLoader::LoadLevelFromFile(std::string filePath){
             default : break;
         }
 
-        // Register current to globals
-        CoreGlobals::nodes[id] = current;
+        // optional draw order
+        if(current && node.HasMember("zindex")) current->zIndex = node["zindex"].GetInt();
+        if(current && node.HasMember("layer")) current->layer = (uint8_t) node["layer"].GetUint();
+
+        // optional collision filter, picked up by CorePhysics::CreateCollider
+        int nodeType = node["type"].GetInt();
+        bool hasCollider = nodeType == GameObject::Type::SPRITE || nodeType == GameObject::Type::EMPTY;
+        if(current && hasCollider && node.HasMember("collision") && node["collision"].IsObject()) {
+            rapidjson::Value &collision = node["collision"].GetObject();
+            CorePhysics::CollisionFilter &filter = reinterpret_cast<GameObject::Empty*>(current)->collisionFilter;
+            if(collision.HasMember("categories")) filter.categories = collision["categories"].GetUint();
+            if(collision.HasMember("mask")) filter.mask = collision["mask"].GetUint();
+        }
+
+        // Register current to globals, factories copy the node into a new object
+        GameObject::RebindNode(current);
+        GameObject::ReserveGameObjectID(id);
+        loadedNodes[id] = current;
         CoreGlobals::_nodes[name].push_back(current);
         
         // parse object state
@@ -154,24 +170,24 @@ bool GameLoader::LoadLevelFromFile(std::string filePath){
         if(!node["parent"].IsNull()) {
             std::string currentId = node["id"].GetString();
             std::string parentId = node["parent"].GetString();
-            if(CoreGlobals::nodes.count(currentId) == 0 || CoreGlobals::nodes.count(parentId) == 0) {
+            if(loadedNodes.count(currentId) == 0 || loadedNodes.count(parentId) == 0) {
                 Debug::Logger("child or parent are invalid, check your level file");
                 return false;
             }
-            GameObject::Node2D* current = CoreGlobals::nodes[currentId];
-            GameObject::Node2D* parent = CoreGlobals::nodes[parentId];
+            GameObject::Node2D* current = loadedNodes[currentId];
+            GameObject::Node2D* parent = loadedNodes[parentId];
             SceneGraph::AttachTo(parent, current);
             Debug::Logger("Node Connected : ", parent->name, " <-> ", current->name);
         }
     }
 
     Debug::Logger("========== Building Scene ===========\n");
-    GameObject::Node2D *root = CoreGlobals::nodes[DOM["root"].GetString()];
+    GameObject::Node2D *root = loadedNodes[DOM["root"].GetString()];
     SceneGraph::Scene *s = SceneGraph::CreateScene(
         DOM["scene_name"].GetString(), 
-        (Camera *) CoreGlobals::nodes[DOM["active_camera"].GetString()],
+        (Camera *) loadedNodes[DOM["active_camera"].GetString()],
         // CoreGlobals::cameras[DOM["active_camera"].GetString()],
-        CoreGlobals::nodes[DOM["root"].GetString()],
+        root,
         DOM["scene_id"].GetString()
         );
     CoreGlobals::activeScene = s;
@@ -196,152 +212,151 @@ bool GameLoader::SaveLevelToFile(SceneGraph::Scene *scene, std::string dir, std:
     nodes.SetArray();
     nodes_details.SetArray();
 
-    // Populate nodes_details
-    std::stack<GameObject::Node2D*> stack;
-    std::set<GameObject::Node2D*> visited;
-    stack.push(scene->sceneRoot);
-    while(!stack.empty()) {
-        GameObject::Node2D* current = stack.top();
-        stack.pop();
-        std::set<Node2D*>::iterator it= visited.find(current);
-        if(it == visited.end()){
-            Debug::Logger("visit : ", current->name);
-            GameObject::Empty *e = reinterpret_cast<GameObject::Empty*>(current);
-
-            // content of node
-            rapidjson::Value node_link;
-            node_link.SetObject();
-            rapidjson::Value parent;
-            parent.SetNull();
-            if(current->parent) {
-                parent.SetString(current->parent->id.c_str(), allocator);
+    // Populate nodes_details, the hierarchy is in pre-order so parents come before children
+    for(GameObject::Node2D *current : scene->hierarchy.nodes) {
+        Debug::Logger("visit : ", current->name);
+        GameObject::Empty *e = reinterpret_cast<GameObject::Empty*>(current);
+
+        // content of node
+        rapidjson::Value node_link;
+        node_link.SetObject();
+        rapidjson::Value parent;
+        parent.SetNull();
+        if(current->parent) {
+            parent.SetString(current->parent->id.c_str(), allocator);
+        }
+        rapidjson::Value aid(current->id.c_str(), allocator);
+        node_link.AddMember("id", aid, allocator);
+        node_link.AddMember("parent", parent, allocator);
+        nodes.PushBack(node_link, allocator);
+
+        // content of node_details
+        rapidjson::Value node; node.SetObject();
+        rapidjson::Value id(current->id.c_str(), allocator);
+        rapidjson::Value name(current->name.c_str(), allocator);
+        rapidjson::Value type; type.SetInt((int) current->type);
+        rapidjson::Value zindex; zindex.SetInt(current->zIndex);
+        rapidjson::Value layer; layer.SetUint(current->layer);
+        rapidjson::Value tag;
+        if(current->tag.empty()) {
+            tag.SetNull();
+        }else{
+            tag.SetString(current->tag.c_str(), allocator);
+        }
+
+        node.AddMember("id", id, allocator);
+        node.AddMember("name", name, allocator);
+        node.AddMember("tag", tag, allocator);
+        node.AddMember("type", type, allocator);
+        node.AddMember("zindex", zindex, allocator);
+        node.AddMember("layer", layer, allocator);
+
+        // node_details transform
+        rapidjson::Value transform;
+        rapidjson::Value pos;
+        rapidjson::Value scale;
+        rapidjson::Value rot;
+        transform.SetObject();
+        pos.SetArray();
+        scale.SetArray();
+        rot.SetFloat(e->transform.rotation);
+        pos.PushBack(e->transform.pos.f[0], allocator);
+        pos.PushBack(e->transform.pos.f[1], allocator);
+        scale.PushBack(e->transform.scale.x, allocator);
+        scale.PushBack(e->transform.scale.y, allocator);
+        transform.AddMember("pos", pos, allocator);
+        transform.AddMember("scale", scale, allocator);
+        transform.AddMember("rot", rot, allocator);
+        node.AddMember("transform", transform, allocator);
+
+        if(current->type == GameObject::Type::SPRITE || current->type == GameObject::Type::EMPTY) {
+            const CorePhysics::CollisionFilter &filter = e->collisionFilter;
+            if(filter.categories != CorePhysics::DEFAULT_CATEGORY || filter.mask != CorePhysics::ALL_CATEGORIES) {
+                rapidjson::Value collision;
+                collision.SetObject();
+                collision.AddMember("categories", filter.categories, allocator);
+                collision.AddMember("mask", filter.mask, allocator);
+                node.AddMember("collision", collision, allocator);
             }
-            rapidjson::Value aid(current->id.c_str(), allocator);
-            node_link.AddMember("id", aid, allocator);
-            node_link.AddMember("parent", parent, allocator);
-            nodes.PushBack(node_link, allocator);
-
-            // content of node_details
-            rapidjson::Value node; node.SetObject();
-            rapidjson::Value id(current->id.c_str(), allocator);
-            rapidjson::Value name(current->name.c_str(), allocator);
-            rapidjson::Value type; type.SetInt((int) current->type);
-            rapidjson::Value zindex; zindex.SetInt(current->zIndex);
-            rapidjson::Value tag;
-            if(current->tag.empty()) {
-                tag.SetNull();
-            }else{
-                tag.SetString(current->tag.c_str(), allocator);
+        }
+        
+        switch(current->type){
+            case GameObject::Type::SPRITE : 
+            {
+                GameObject::Sprite *sp = reinterpret_cast<GameObject::Sprite*>(current);
+                rapidjson::Value mId(sp->material->id.c_str(), allocator);
+                node.AddMember("material", mId, allocator);
+                SaveGameResourceToFile(sp->material);
+                break;
             }
+            case GameObject::Type::CAMERA : 
+            {
+                GameObject::Camera *cm = reinterpret_cast<GameObject::Camera*>(current);
+                rapidjson::Value up;
+                up.SetArray();
+                up.PushBack(cm->up.f[0], allocator);
+                up.PushBack(cm->up.f[1], allocator);
+                up.PushBack(cm->up.f[2], allocator);
+                up.PushBack(cm->up.f[3], allocator);
+                node.AddMember("up", up, allocator);
+                break;
+            }
+            case GameObject::Type::TEXT : 
+            {
+                GameObject::Text *text = reinterpret_cast<GameObject::Text*>(current);
+                rapidjson::Value width;
+                width.SetInt(text->width);
+                rapidjson::Value height;
+                height.SetInt(text->height);
+                rapidjson::Value size(text->size);// size.SetInt(text->size);
+                rapidjson::Value font(text->font->id.c_str(), allocator);
+                rapidjson::Value textContent(text->text.c_str(), allocator);
+                node.AddMember("width", width, allocator);
+                node.AddMember("height", height, allocator);
+                node.AddMember("size", size, allocator);
+                node.AddMember("font", font, allocator);
+                node.AddMember("text", textContent, allocator);
+                SaveGameResourceToFile(text->font);
+                break;
+            }
+            default : break;
+        }
 
-            node.AddMember("id", id, allocator);
-            node.AddMember("name", name, allocator);
-            node.AddMember("tag", tag, allocator);
-            node.AddMember("type", type, allocator);
-            node.AddMember("zindex", zindex, allocator);
-
-            // node_details transform
-            rapidjson::Value transform;
-            rapidjson::Value pos;
-            rapidjson::Value scale;
-            rapidjson::Value rot;
-            transform.SetObject();
-            pos.SetArray();
-            scale.SetArray();
-            rot.SetFloat(e->transform.rotation);
-            pos.PushBack(e->transform.pos.f[0], allocator);
-            pos.PushBack(e->transform.pos.f[1], allocator);
-            scale.PushBack(e->transform.scale.x, allocator);
-            scale.PushBack(e->transform.scale.y, allocator);
-            transform.AddMember("pos", pos, allocator);
-            transform.AddMember("scale", scale, allocator);
-            transform.AddMember("rot", rot, allocator);
-            node.AddMember("transform", transform, allocator);
-            
-            switch(current->type){
-                case GameObject::Type::SPRITE : 
-                {
-                    GameObject::Sprite *sp = reinterpret_cast<GameObject::Sprite*>(current);
-                    rapidjson::Value mId(sp->material->id.c_str(), allocator);
-                    node.AddMember("material", mId, allocator);
-                    SaveGameResourceToFile(sp->material);
-                    break;
-                }
-                case GameObject::Type::CAMERA : 
+        // Meta Serialize
+        rapidjson::Value state;
+        state.SetArray();
+        // Save each recent states
+        if(current->behavior.Serialize) {
+            current->behavior.Serialize(current);
+        }
+        for(auto &metaField : current->meta) {
+            rapidjson::Value field;
+            rapidjson::Value fieldType;
+            rapidjson::Value fieldName;
+            rapidjson::Value fieldValue;
+
+            field.SetObject();
+            fieldName.SetString(metaField.name.c_str(), (metaField.name.length()), allocator);
+            fieldType.SetInt((int) metaField.type);
+            field.AddMember("type", fieldType, allocator);
+            field.AddMember("name", fieldName, allocator);
+
+            switch (metaField.type) {
+                case meta_int : 
                 {
-                    GameObject::Camera *cm = reinterpret_cast<GameObject::Camera*>(current);
-                    rapidjson::Value up;
-                    up.SetArray();
-                    up.PushBack(cm->up.f[0], allocator);
-                    up.PushBack(cm->up.f[1], allocator);
-                    up.PushBack(cm->up.f[2], allocator);
-                    up.PushBack(cm->up.f[3], allocator);
-                    node.AddMember("up", up, allocator);
-                    break;
-                }
-                case GameObject::Type::TEXT : 
+                    fieldValue.SetInt(metaField.value_i);
+                } break;
+                case meta_float : 
                 {
-                    GameObject::Text *text = reinterpret_cast<GameObject::Text*>(current);
-                    rapidjson::Value width;
-                    width.SetInt(text->width);
-                    rapidjson::Value height;
-                    height.SetInt(text->height);
-                    rapidjson::Value size(text->size);// size.SetInt(text->size);
-                    rapidjson::Value font(text->font->id.c_str(), allocator);
-                    rapidjson::Value textContent(text->text.c_str(), allocator);
-                    node.AddMember("width", width, allocator);
-                    node.AddMember("height", height, allocator);
-                    node.AddMember("size", size, allocator);
-                    node.AddMember("font", font, allocator);
-                    node.AddMember("text", textContent, allocator);
-                    SaveGameResourceToFile(text->font);
-                    break;
-                }
-                default : break;
-            }
-
-            // Meta Serialize
-            rapidjson::Value state;
-            state.SetArray();
-            // Save each recent states
-            if(current->behavior.Serialize) {
-                current->behavior.Serialize(current);
-            }
-            for(auto &metaField : current->meta) {
-                rapidjson::Value field;
-                rapidjson::Value fieldType;
-                rapidjson::Value fieldName;
-                rapidjson::Value fieldValue;
-
-                field.SetObject();
-                fieldName.SetString(metaField.name.c_str(), (metaField.name.length()), allocator);
-                fieldType.SetInt((int) metaField.type);
-                field.AddMember("type", fieldType, allocator);
-                field.AddMember("name", fieldName, allocator);
-
-                switch (metaField.type) {
-                    case meta_int : 
-                    {
-                        fieldValue.SetInt(metaField.value_i);
-                    } break;
-                    case meta_float : 
-                    {
-                        fieldValue.SetFloat(metaField.value_f);
-                    } break;
-                    default: break;
-                }
-                field.AddMember("value", fieldValue, allocator);
-                state.PushBack(field, allocator);
-            }
-            node.AddMember("state", state, allocator);
-            nodes_details.PushBack(node, allocator);
-            
-            visited.insert(current);
-            for(auto &v : current->children){
-                stack.push(v);
+                    fieldValue.SetFloat(metaField.value_f);
+                } break;
+                default: break;
             }
+            field.AddMember("value", fieldValue, allocator);
+            state.PushBack(field, allocator);
         }
-    // End of traversal
+        node.AddMember("state", state, allocator);
+        nodes_details.PushBack(node, allocator);
     }
 
     rapidjson::Value scene_id(scene->id.c_str(), allocator);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <core/CoreGlobals.h>
 #include <core/GameObject_impl.h>
 #include <core/GameResource_impl.h>
@@ -9,7 +10,7 @@
 
 using namespace GameObject;
 
-std::unordered_map<std::string, GameObject::Node2D*> CoreGlobals::nodes;
+GameObject::NodeRegistry CoreGlobals::nodes;
 std::unordered_map<std::string, std::vector<GameObject::Node2D*>> CoreGlobals::_nodes;
 unsigned long CoreGlobals::nodeLastId = 100;
 unsigned long CoreGlobals::emptyLastId = 100;
@@ -18,42 +19,179 @@ unsigned long CoreGlobals::cameraLastId = 100;
 unsigned long CoreGlobals::textLastId = 100;
 
 
+// Counters only move forward and loaded ids are reserved, so no lookup is needed
 std::string GameObject::GenerateGameObjectID(Type type){
-    std::string id;
-    do {
-        // Increment IDs until no duplicates were found
-        switch(type) {
-            case Type::SPRITE :
-            {
-                id = std::string("S" + std::to_string(CoreGlobals::spriteLastId++));
-            }break;
-            case Type::ANIMATED_SPRITE :
-            {
-                id = std::string("AS" + std::to_string(CoreGlobals::spriteLastId++));
-            }break;
-            case Type::CAMERA :
-            {
-                id = std::string("C" + std::to_string(CoreGlobals::cameraLastId++));
-            }break;
-            case Type::NODE2D :
-            {
-                id = std::string("N" + std::to_string(CoreGlobals::nodeLastId++));
-            }break;
-            case Type::EMPTY :
-            {
-                id =  std::string("E" + std::to_string(CoreGlobals::emptyLastId++));
-            }break;
-            case Type::TEXT :
-            {
-                id =  std::string("T" + std::to_string(CoreGlobals::textLastId++));
-            }break;
-            default :
-            {
-                id = std::string("S" + std::to_string(CoreGlobals::spriteLastId++));
-            }
-        };
-    } while(CoreGlobals::nodes.count(id) >= 1);
-    return id;
+    switch(type) {
+        case Type::SPRITE : return "S" + std::to_string(CoreGlobals::spriteLastId++);
+        case Type::ANIMATED_SPRITE : return "AS" + std::to_string(CoreGlobals::spriteLastId++);
+        case Type::CAMERA : return "C" + std::to_string(CoreGlobals::cameraLastId++);
+        case Type::NODE2D : return "N" + std::to_string(CoreGlobals::nodeLastId++);
+        case Type::EMPTY : return "E" + std::to_string(CoreGlobals::emptyLastId++);
+        case Type::TEXT : return "T" + std::to_string(CoreGlobals::textLastId++);
+        default : return "S" + std::to_string(CoreGlobals::spriteLastId++);
+    }
+}
+
+
+void GameObject::ReserveGameObjectID(const std::string &id) {
+    size_t digits = id.find_first_of("0123456789");
+    if(digits == std::string::npos || digits == 0) return;
+    std::string prefix = id.substr(0, digits);
+    unsigned long *counter = nullptr;
+    if(prefix == "S" || prefix == "AS") counter = &CoreGlobals::spriteLastId;
+    else if(prefix == "C") counter = &CoreGlobals::cameraLastId;
+    else if(prefix == "N") counter = &CoreGlobals::nodeLastId;
+    else if(prefix == "E") counter = &CoreGlobals::emptyLastId;
+    else if(prefix == "T") counter = &CoreGlobals::textLastId;
+    if(!counter) return;
+    try{
+        unsigned long value = std::stoul(id.substr(digits));
+        if(value >= *counter) *counter = value + 1;
+    }catch(const std::exception &e) {
+        // not a generated id, nothing to reserve
+    }
+}
+
+
+/*
+ * Node handles
+ * */
+
+
+NodeHandle GameObject::RegisterNode(Node2D *node) {
+    NodeRegistry &registry = CoreGlobals::nodes;
+    uint32_t index;
+    if(registry.freeSlot != 0xFFFFFFFF) {
+        index = registry.freeSlot;
+        registry.freeSlot = registry.slots[index].dense;
+    }else{
+        index = (uint32_t) registry.slots.size();
+        registry.slots.push_back(NodeSlot{nullptr, 1, 0});
+    }
+    NodeSlot &slot = registry.slots[index];
+    slot.node = node;
+    slot.dense = (uint32_t) registry.nodes.size();
+    registry.nodes.push_back(node);
+    registry.denseSlots.push_back(index);
+    node->handle = NodeHandle{index, slot.generation};
+    return node->handle;
+}
+
+
+bool GameObject::UnregisterNode(NodeHandle handle) {
+    if(!IsValidNode(handle)) {
+        Debug::Logger("GameObject:: stale node handle ", handle.index);
+        return false;
+    }
+    NodeRegistry &registry = CoreGlobals::nodes;
+    NodeSlot &slot = registry.slots[handle.index];
+    // swap remove keeps the live nodes packed
+    uint32_t last = (uint32_t) registry.nodes.size() - 1;
+    registry.nodes[slot.dense] = registry.nodes[last];
+    registry.denseSlots[slot.dense] = registry.denseSlots[last];
+    registry.slots[registry.denseSlots[slot.dense]].dense = slot.dense;
+    registry.nodes.pop_back();
+    registry.denseSlots.pop_back();
+
+    slot.node->handle = INVALID_NODE;
+    slot.node = nullptr;
+    slot.generation++;
+    if(slot.generation == 0) slot.generation = 1;
+    slot.dense = registry.freeSlot;
+    registry.freeSlot = handle.index;
+    return true;
+}
+
+
+bool GameObject::RebindNode(Node2D *node) {
+    if(!IsValidNode(node->handle)) return false;
+    NodeSlot &slot = CoreGlobals::nodes.slots[node->handle.index];
+    slot.node = node;
+    CoreGlobals::nodes.nodes[slot.dense] = node;
+    return true;
+}
+
+
+Node2D* GameObject::GetNode(NodeHandle handle) {
+    return IsValidNode(handle) ? CoreGlobals::nodes.slots[handle.index].node : nullptr;
+}
+
+
+bool GameObject::IsValidNode(NodeHandle handle) {
+    const NodeRegistry &registry = CoreGlobals::nodes;
+    return handle.index < registry.slots.size()
+        && registry.slots[handle.index].generation == handle.generation
+        && registry.slots[handle.index].node != nullptr;
+}
+
+
+const std::vector<Node2D*>& GameObject::GetAllNodes() {
+    return CoreGlobals::nodes.nodes;
+}
+
+
+// Frees what one node owns outside of the scene graph and deletes it as the
+// type it was created with, its children were freed before it
+static void FreeNode(Node2D *node) {
+    for(Node2D *child : node->children) FreeNode(child);
+
+    if(node->type == Type::EMPTY || node->type == Type::SPRITE || node->type == Type::ANIMATED_SPRITE) {
+        // Empty, Sprite and AnimatedSprite share the layout up to the collider
+        CorePhysics::ColliderHandle collider = reinterpret_cast<Empty*>(node)->collider;
+        if(CoreGlobals::physicsWorld && CorePhysics::IsValidCollider(collider)) {
+            CorePhysics::DestroyCollider(collider);
+        }
+    }
+
+    auto named = CoreGlobals::_nodes.find(node->name);
+    if(named != CoreGlobals::_nodes.end()) {
+        std::vector<Node2D*> &list = named->second;
+        list.erase(std::remove(list.begin(), list.end(), node), list.end());
+        if(list.empty()) CoreGlobals::_nodes.erase(named);
+    }
+    GameObject::UnregisterNode(node->handle);
+
+    switch(node->type) {
+        case Type::EMPTY:
+            delete reinterpret_cast<Empty*>(node);
+            break;
+        case Type::SPRITE:
+            Graphics::RemoveGeometry(reinterpret_cast<Sprite*>(node));
+            delete reinterpret_cast<Sprite*>(node);
+            break;
+        case Type::ANIMATED_SPRITE:
+            Graphics::RemoveGeometry(reinterpret_cast<Sprite*>(node));
+            delete reinterpret_cast<AnimatedSprite*>(node);
+            break;
+        case Type::CAMERA:
+            delete reinterpret_cast<Camera*>(node);
+            break;
+        case Type::TEXT:
+            Graphics::RemoveGeometry(reinterpret_cast<Text*>(node));
+            delete[] reinterpret_cast<Text*>(node)->surfaceBuffer;
+            delete reinterpret_cast<Text*>(node);
+            break;
+        default:
+            delete node;
+            break;
+    }
+}
+
+
+bool GameObject::DestroyNode(Node2D *node) {
+    if(!node || !IsValidNode(node->handle)) {
+        Debug::Logger("GameObject:: destroying a node that is not registered");
+        return false;
+    }
+    // the subtree leaves its parent and scene in one piece, then every
+    // node of it is freed without touching the scene again
+    if(node->parent) {
+        SceneGraph::Detach(node);
+    }else if(node->scene) {
+        SceneGraph::RemoveFromScene(node);
+    }
+    FreeNode(node);
+    return true;
 }
 
 
@@ -62,7 +200,7 @@ Node2D* GameObject::CreateNode2D(std::string name) {
     newNode2D->id = GenerateGameObjectID(Type::NODE2D);
     newNode2D->name = name;
     newNode2D->type = Type::NODE2D;
-    CoreGlobals::nodes[newNode2D->id] = newNode2D;
+    RegisterNode(newNode2D);
     CoreGlobals::_nodes[newNode2D->name].push_back((Node2D*) newNode2D);
     Debug::Logger("GameObject:: success creating object with id : ", newNode2D->id, "\n");
     return newNode2D;
@@ -84,11 +222,11 @@ Empty* GameObject::CreateEmptyObject(
     newEmpty->transform.pos = Vector4{position.x, position.y, 0.0f, 1.0f};
     newEmpty->transform.scale = scale;
     newEmpty->transform.rotation = rotation;
-    newEmpty->transform.World = CoreMath::IdentityMatrix();
-    newEmpty->transform.Local = CoreMath::IdentityMatrix();
+    newEmpty->transform.World = CoreMath::IdentityAffine2D();
+    newEmpty->transform.Local = CoreMath::IdentityAffine2D();
     newEmpty->attribute.parent = nullptr;
+    RegisterNode((Node2D*) newEmpty);
     if(id.empty()) {
-        CoreGlobals::nodes[newEmpty->attribute.id] = (Node2D*) newEmpty;
         CoreGlobals::_nodes[newEmpty->attribute.name].push_back((Node2D*) newEmpty);
     }
     Debug::Logger("GameObject:: success creating object with id : ", newEmpty->attribute.id, "\n");
@@ -116,8 +254,8 @@ Sprite* GameObject::CreateSprite(
     newSprite->transform.pos = Vector4{position.x, position.y, 0.0f, 1.0f};
     newSprite->transform.rotation = rotation;
     newSprite->transform.scale = scale;
-    newSprite->transform.World = CoreMath::IdentityMatrix();
-    newSprite->transform.Local = CoreMath::IdentityMatrix();
+    newSprite->transform.World = CoreMath::IdentityAffine2D();
+    newSprite->transform.Local = CoreMath::IdentityAffine2D();
 
     if(material == nullptr){
         newSprite->material = GameResource::GetDefaultMaterial();
@@ -135,16 +273,17 @@ Sprite* GameObject::CreateSprite(
         {-texW, -texH, 0.0f, 1.0f},
     };
 
-    newSprite->geometry.AABB = CoreGeometry::CreateAABB(newSprite->geometry.vertices);
+    newSprite->geometry.halfExtents = Vector2{texW, texH};
+    newSprite->geometry.AABB = CoreGeometry::CreateAABB(newSprite->geometry.halfExtents);
 
     if(!Graphics::CreateGeometry(newSprite)) {
         Debug::Logger("GameObject:: Fail register sprite with name : ", name);
         return nullptr;
     }
+    RegisterNode((Node2D*) newSprite);
     if(id.empty()) {
-        // Only register when id is empty, because creation is handled on GameLoader (ln 104)
+        // Only register the name when id is empty, because creation is handled on GameLoader
         // 'id' signaling that this object has id defined in level file
-        CoreGlobals::nodes[newSprite->attribute.id] = (Node2D*) newSprite;
         CoreGlobals::_nodes[newSprite->attribute.name].push_back((Node2D*) newSprite);
     }
     Debug::Logger("GameObject:: success creating object with id : ", newSprite->attribute.id, "\n");
@@ -179,8 +318,8 @@ AnimatedSprite* GameObject::CreateAnimatedSprite(
     newAnimatedSprite->sprite.transform.pos = Vector4{position.x, position.y, 0.0f, 1.0f};
     newAnimatedSprite->sprite.transform.rotation = rotation;
     newAnimatedSprite->sprite.transform.scale = scale;
-    newAnimatedSprite->sprite.transform.World = CoreMath::IdentityMatrix();
-    newAnimatedSprite->sprite.transform.Local = CoreMath::IdentityMatrix();
+    newAnimatedSprite->sprite.transform.World = CoreMath::IdentityAffine2D();
+    newAnimatedSprite->sprite.transform.Local = CoreMath::IdentityAffine2D();
     newAnimatedSprite->frameDimension = frameDimension;
     newAnimatedSprite->currentFrame = startFrame;
     newAnimatedSprite->fps = fps;
@@ -210,16 +349,17 @@ AnimatedSprite* GameObject::CreateAnimatedSprite(
     newAnimatedSprite->frameDimensionNormalized.y = frameDimension.y / texH;
     newAnimatedSprite->pitch = texW / frameDimension.x;
 
-    newAnimatedSprite->sprite.geometry.AABB = CoreGeometry::CreateAABB(newAnimatedSprite->sprite.geometry.vertices);
+    newAnimatedSprite->sprite.geometry.halfExtents = Vector2{hW, hH};
+    newAnimatedSprite->sprite.geometry.AABB = CoreGeometry::CreateAABB(newAnimatedSprite->sprite.geometry.halfExtents);
 
     if(!Graphics::CreateGeometry(&newAnimatedSprite->sprite)) {
         Debug::Logger("GameObject:: Fail register sprite with name : ", name);
         return nullptr;
     }
+    RegisterNode((Node2D*) newAnimatedSprite);
     if(id.empty()) {
-        // Only register when id is empty, because creation is handled on GameLoader (ln 104)
+        // Only register the name when id is empty, because creation is handled on GameLoader
         // 'id' signaling that this object has id defined in level file
-        CoreGlobals::nodes[newAnimatedSprite->sprite.attribute.id] = (Node2D*) newAnimatedSprite;
         CoreGlobals::_nodes[newAnimatedSprite->sprite.attribute.name].push_back((Node2D*) newAnimatedSprite);
     }
     Debug::Logger("GameObject:: success creating object with id : ", newAnimatedSprite->sprite.attribute.id, "\n");
@@ -248,10 +388,11 @@ Camera* GameObject::CreateCamera(std::string name, std::string tag, const Vector
         {hw, -hh, 0.0f, 1.0f},
         {-hw, -hh, 0.0f, 1.0f},
     };
+    newCamera->geometry.halfExtents = Vector2{hw, hh};
     newCamera->geometry.showBoundingRect = true;
     newCamera->view = CoreMath::ViewSpaceMatrix(newCamera->transform.pos, newCamera->up);
+    RegisterNode((Node2D*) newCamera);
     if(id.empty()) {
-        CoreGlobals::nodes[newCamera->attribute.id] = (Node2D*) newCamera;
         CoreGlobals::_nodes[newCamera->attribute.name].push_back((Node2D*) newCamera);
     }
     Debug::Logger("GameObject:: success creating object with id : ", newCamera->attribute.id, "\n");
@@ -268,8 +409,8 @@ Text* GameObject::CreateText(std::string text, std::string name, GameResource::F
     newText->attribute.type = Type::TEXT;
     newText->font = font;
     // newText->attribute.tag = "null";
-    newText->transform.World = CoreMath::IdentityMatrix();
-    newText->transform.Local = CoreMath::IdentityMatrix();
+    newText->transform.World = CoreMath::IdentityAffine2D();
+    newText->transform.Local = CoreMath::IdentityAffine2D();
     newText->text = text;
 
     FontLoader::RenderText(
@@ -294,14 +435,74 @@ Text* GameObject::CreateText(std::string text, std::string name, GameResource::F
         {hw, -hh, 0.0f, 1.0f},
         {-hw, -hh, 0.0f, 1.0f},
     };
-    newText->geometry.AABB = CoreGeometry::CreateAABB(newText->geometry.vertices);
+    newText->geometry.halfExtents = Vector2{hw, hh};
+    newText->geometry.AABB = CoreGeometry::CreateAABB(newText->geometry.halfExtents);
     if(!Graphics::CreateGeometry(newText)){
         Debug::Logger("GameObject:: fail creating Text geometry with id : ", newText->attribute.id, "\n");
     }
+    RegisterNode((Node2D*) newText);
     if(id.empty()) {
-        CoreGlobals::nodes[newText->attribute.id] = (Node2D*) newText;
         CoreGlobals::_nodes[newText->attribute.name].push_back((Node2D*) newText);
     }
     Debug::Logger("GameObject:: success creating Text object with id : ", newText->attribute.id, "\n");
     return newText;
 }
+
+
+/*
+ * Transforms
+ * Every node type starts with Node2D attribute then Transform2D transform.
+ * */
+
+
+static inline Transform2D* GetTransform(Node2D *node) {
+    return &reinterpret_cast<Empty*>(node)->transform;
+}
+
+
+// Empty, Sprite and AnimatedSprite keep the collider right after the transform
+static inline void NotifyCollider(Node2D *node) {
+    if(node->type != EMPTY && node->type != SPRITE && node->type != ANIMATED_SPRITE) return;
+    CorePhysics::ColliderHandle collider = reinterpret_cast<Empty*>(node)->collider;
+    if(CoreGlobals::physicsWorld && CorePhysics::IsValidCollider(collider)) {
+        CorePhysics::MarkOwnerMoved(collider);
+    }
+}
+
+
+void GameObject::SetPosition(Node2D *node, const Vector2 &pos) {
+    Transform2D *transform = GetTransform(node);
+    transform->pos.x = pos.x;
+    transform->pos.y = pos.y;
+    SceneGraph::QueueTransform(node);
+    NotifyCollider(node);
+}
+
+
+void GameObject::Translate(Node2D *node, const Vector2 &delta) {
+    Transform2D *transform = GetTransform(node);
+    transform->pos.x += delta.x;
+    transform->pos.y += delta.y;
+    SceneGraph::QueueTransform(node);
+    NotifyCollider(node);
+}
+
+
+void GameObject::SetScale(Node2D *node, const Vector2 &scale) {
+    Transform2D *transform = GetTransform(node);
+    transform->scale = scale;
+    SceneGraph::QueueTransform(node);
+}
+
+
+void GameObject::SetRotation(Node2D *node, float degrees) {
+    Transform2D *transform = GetTransform(node);
+    transform->rotation = degrees;
+    SceneGraph::QueueTransform(node);
+}
+
+
+void GameObject::MarkTransformDirty(Node2D *node) {
+    SceneGraph::QueueTransform(node);
+    NotifyCollider(node);
+}
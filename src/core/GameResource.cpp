@@ -31,6 +31,13 @@ static std::string GenerateResourceID(Signature signature) {
 }
 
 
+static uint32_t nextSortId = 1;
+
+static uint32_t GenerateSortID() {
+    return nextSortId++;
+}
+
+
 /*
  * Game Resource expose functions
  * */
@@ -50,6 +57,7 @@ Texture* GameResource::CreateTexture(std::string name, std::string filePath, std
     newTexture->id = id.empty() ? GenerateResourceID(Signature::TEXTURE) : id;
     newTexture->filePath = filePath;
     newTexture->name = name;
+    newTexture->sortId = GenerateSortID();
 
     if(!Graphics::CreateTexture(newTexture)){
         Debug::Logger("GameResource:: Error while constructing texture with platform graphics");
@@ -103,6 +111,7 @@ Shader* GameResource::CreateShader(std::string name, std::string filePath, std::
         newShader->id = id.empty() ? GenerateResourceID(Signature::SHADER) : id;
         newShader->filePath = filePath;
         newShader->name = name;
+        newShader->sortId = GenerateSortID();
 
         if(!Graphics::CreateShader(newShader)){
             Debug::Logger("GameResource:: Error while constructing shader with platform graphics");
@@ -161,6 +170,7 @@ Material* GameResource::CreateMaterial(
     Material *newMaterial = new Material;
     newMaterial->id = id.empty() ? GenerateResourceID(Signature::MATERIAL) : id;
     newMaterial->name = name;
+    newMaterial->sortId = GenerateSortID();
 
     if(!shader){
         newMaterial->shader = GetDefaultShader();
@@ -254,6 +264,7 @@ GameResource::Font* GameResource::CreateFontResource(std::string fontPath, uint3
     newFontResource->name = font->family;
     newFontResource->id = id.empty() ? GenerateResourceID(Signature::FONT) : id;
     newFontResource->filePath = fontPath;
+    newFontResource->sortId = GenerateSortID();
     if(CoreGlobals::fonts.count(newFontResource->id) > 0) {
         FreeFontResource(CoreGlobals::fonts[newFontResource->id]);
         delete CoreGlobals::fonts[newFontResource->id];
@@ -1,57 +1,884 @@
 #include <core/Geometry.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utils/Debug.h>
 
 using namespace CoreGeometry;
 
-BoundingRect CoreGeometry::CreateAABB(std::vector<Vector4> vertices, Matrix transform) {
-    std::vector<Vector4> _vertices;
-    for(Vector4 &vertex : vertices) {
-        _vertices.push_back(CoreMath::Multiply(transform, vertex));
-    }
+BoundingRect CoreGeometry::CreateAABB(const std::vector<Vector4> &vertices, const Affine2D &transform) {
+    BoundingRect aabb;
+    UpdateAABB(&aabb, vertices, transform);
+    return aabb;
+}
+
 
-    float maxX = _vertices[0].x; 
-    float minX = _vertices[0].x;
-    float maxY = _vertices[0].y;
-    float minY = _vertices[0].y;
-    for(Vector4 v : _vertices) {
+void CoreGeometry::UpdateAABB(BoundingRect *rect, const std::vector<Vector4> &vertices, const Affine2D &transform) {
+    Vector2 first = CoreMath::TransformPoint(transform, vertices[0].xy);
+    float maxX = first.x; 
+    float minX = first.x;
+    float maxY = first.y;
+    float minY = first.y;
+    for(const Vector4 &vertex : vertices) {
+        Vector2 v = CoreMath::TransformPoint(transform, vertex.xy);
         maxX = std::max(v.x, maxX);
         maxY = std::max(v.y, maxY);
         minX = std::min(v.x, minX);
         minY = std::min(v.y, minY);
     }
 
+    rect->bound = {minX, minY, maxX, maxY};
+}
+
+
+BoundingRect CoreGeometry::CreateAABB(const Vector2 &halfExtents, const Affine2D &transform) {
     BoundingRect aabb;
-    aabb.bound = {minX, minY, maxX, maxY};
+    UpdateAABB(&aabb, halfExtents, transform);
     return aabb;
 }
 
 
-void CoreGeometry::UpdateAABB(BoundingRect *rect, std::vector<Vector4> vertices, Matrix transform) {
-    std::vector<Vector4> _vertices;
-    for(Vector4 &vertex : vertices) {
-        _vertices.push_back(CoreMath::Multiply(transform, vertex));
+void CoreGeometry::UpdateAABB(BoundingRect *rect, const Vector2 &halfExtents, const Affine2D &transform) {
+    float ex = std::abs(transform.m11) * halfExtents.x + std::abs(transform.m12) * halfExtents.y;
+    float ey = std::abs(transform.m21) * halfExtents.x + std::abs(transform.m22) * halfExtents.y;
+    rect->bound = {
+        transform.m13 - ex,
+        transform.m23 - ey,
+        transform.m13 + ex,
+        transform.m23 + ey
+    };
+}
+
+
+void CoreGeometry::UpdateAABBs(BoundingRect *rects, const Vector2 *halfExtents, const Affine2D *transforms, uint32_t count) {
+    uint32_t i = 0;
+#if CORE_MATH_SSE2
+    // 4 rects per iteration, inputs are gathered into one lane per rect
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    for(; i + 4 <= count; i += 4) {
+        const Affine2D *t = transforms + i;
+        const Vector2 *h = halfExtents + i;
+        __m128 m11 = _mm_set_ps(t[3].m11, t[2].m11, t[1].m11, t[0].m11);
+        __m128 m12 = _mm_set_ps(t[3].m12, t[2].m12, t[1].m12, t[0].m12);
+        __m128 m21 = _mm_set_ps(t[3].m21, t[2].m21, t[1].m21, t[0].m21);
+        __m128 m22 = _mm_set_ps(t[3].m22, t[2].m22, t[1].m22, t[0].m22);
+        __m128 cx  = _mm_set_ps(t[3].m13, t[2].m13, t[1].m13, t[0].m13);
+        __m128 cy  = _mm_set_ps(t[3].m23, t[2].m23, t[1].m23, t[0].m23);
+        __m128 hx  = _mm_set_ps(h[3].x, h[2].x, h[1].x, h[0].x);
+        __m128 hy  = _mm_set_ps(h[3].y, h[2].y, h[1].y, h[0].y);
+
+        __m128 ex = _mm_add_ps(
+            _mm_mul_ps(_mm_and_ps(m11, absMask), hx),
+            _mm_mul_ps(_mm_and_ps(m12, absMask), hy)
+            );
+        __m128 ey = _mm_add_ps(
+            _mm_mul_ps(_mm_and_ps(m21, absMask), hx),
+            _mm_mul_ps(_mm_and_ps(m22, absMask), hy)
+            );
+
+        // lanes are rects, transpose back to minX, minY, maxX, maxY per rect
+        __m128 minX = _mm_sub_ps(cx, ex);
+        __m128 minY = _mm_sub_ps(cy, ey);
+        __m128 maxX = _mm_add_ps(cx, ex);
+        __m128 maxY = _mm_add_ps(cy, ey);
+        _MM_TRANSPOSE4_PS(minX, minY, maxX, maxY);
+        _mm_storeu_ps(rects[i + 0].bound.minmax.f, minX);
+        _mm_storeu_ps(rects[i + 1].bound.minmax.f, minY);
+        _mm_storeu_ps(rects[i + 2].bound.minmax.f, maxX);
+        _mm_storeu_ps(rects[i + 3].bound.minmax.f, maxY);
+    }
+#endif
+    for(; i < count; i++) {
+        UpdateAABB(&rects[i], halfExtents[i], transforms[i]);
     }
+}
 
-    float maxX = _vertices[0].x; 
-    float minX = _vertices[0].x;
-    float maxY = _vertices[0].y;
-    float minY = _vertices[0].y;
-    for(Vector4 v : _vertices) {
-        maxX = std::max(v.x, maxX);
-        maxY = std::max(v.y, maxY);
-        minX = std::min(v.x, minX);
-        minY = std::min(v.y, minY);
+
+bool CoreGeometry::Intersect(BoundingRect *b1, BoundingRect *b2) {
+    // separating axis test, also true when either rect contains the other
+    return (b1->bound.minX <= b2->bound.maxX) && (b1->bound.maxX >= b2->bound.minX) &&
+           (b1->bound.minY <= b2->bound.maxY) && (b1->bound.maxY >= b2->bound.minY);
+}
+
+
+uint32_t CoreGeometry::CullAABBs(const BoundingRect &camera, const BoundingRect *bounds, uint32_t count, uint32_t *visibleIndices) {
+    uint32_t visible = 0;
+    uint32_t i = 0;
+#if CORE_MATH_SSE2
+    // 4 bounds per iteration, transposed so each register holds one edge
+    const __m128 camMinX = _mm_set1_ps(camera.bound.minX);
+    const __m128 camMinY = _mm_set1_ps(camera.bound.minY);
+    const __m128 camMaxX = _mm_set1_ps(camera.bound.maxX);
+    const __m128 camMaxY = _mm_set1_ps(camera.bound.maxY);
+    for(; i + 4 <= count; i += 4) {
+        __m128 minX = _mm_loadu_ps(bounds[i + 0].bound.minmax.f);
+        __m128 minY = _mm_loadu_ps(bounds[i + 1].bound.minmax.f);
+        __m128 maxX = _mm_loadu_ps(bounds[i + 2].bound.minmax.f);
+        __m128 maxY = _mm_loadu_ps(bounds[i + 3].bound.minmax.f);
+        _MM_TRANSPOSE4_PS(minX, minY, maxX, maxY);
+        __m128 overlap = _mm_and_ps(
+            _mm_and_ps(_mm_cmple_ps(minX, camMaxX), _mm_cmpge_ps(maxX, camMinX)),
+            _mm_and_ps(_mm_cmple_ps(minY, camMaxY), _mm_cmpge_ps(maxY, camMinY))
+            );
+        int mask = _mm_movemask_ps(overlap);
+        // branchless compaction
+        visibleIndices[visible] = i + 0; visible += (mask >> 0) & 1;
+        visibleIndices[visible] = i + 1; visible += (mask >> 1) & 1;
+        visibleIndices[visible] = i + 2; visible += (mask >> 2) & 1;
+        visibleIndices[visible] = i + 3; visible += (mask >> 3) & 1;
+    }
+#endif
+    for(; i < count; i++) {
+        const BoundingRect &b = bounds[i];
+        bool overlap = 
+            (b.bound.minX <= camera.bound.maxX) && (b.bound.maxX >= camera.bound.minX) &&
+            (b.bound.minY <= camera.bound.maxY) && (b.bound.maxY >= camera.bound.minY);
+        visibleIndices[visible] = i;
+        visible += overlap ? 1 : 0;
     }
+    return visible;
+}
 
-    rect->bound = {minX, minY, maxX, maxY};
+
+/*
+ * Shapes
+ * */
+
+
+Shape CoreGeometry::CreateCircle(const Vector2 &center, float radius) {
+    Shape shape;
+    shape.type = SHAPE_CIRCLE;
+    shape.circle = Circle{center, radius};
+    return shape;
 }
 
 
-bool CoreGeometry::Intersect(BoundingRect *b1, BoundingRect *b2) {
-    bool lIntersect = (b1->bound.minX <= b2->bound.minX) && (b1->bound.maxX >= b2->bound.minX);
-    bool rIntersect = (b1->bound.minX <= b2->bound.maxX) && (b1->bound.maxX >= b2->bound.maxX);
-    bool tIntersect = (b1->bound.minY <= b2->bound.maxY) && (b1->bound.maxY >= b2->bound.maxY);
-    bool bIntersect = (b1->bound.minY <= b2->bound.minY) && (b1->bound.maxY >= b2->bound.minY);
+Shape CoreGeometry::CreateCapsule(const Vector2 &p1, const Vector2 &p2, float radius) {
+    Shape shape;
+    shape.type = SHAPE_CAPSULE;
+    shape.capsule = Capsule{p1, p2, radius};
+    return shape;
+}
+
+
+Shape CoreGeometry::CreateBox(const Vector2 &halfExtents, const Vector2 &center, float rotation) {
+    Shape shape;
+    shape.type = SHAPE_BOX;
+    shape.box = OrientedBox{center, halfExtents, rotation};
+    return shape;
+}
+
+
+static const float POLYGON_AREA_EPSILON = 1.0e-6f;
+
+
+static void ComputePolygonNormals(Vector2 *vertices, Vector2 *normals, uint32_t count) {
+    for(uint32_t i = 0; i < count; i++) {
+        Vector2 edge = CoreMath::VectorSubtract(vertices[(i + 1) % count], vertices[i]);
+        normals[i] = CoreMath::Normalize(Vector2{edge.y, -edge.x});
+    }
+}
+
+
+static float SignedArea(const Vector2 *vertices, uint32_t count) {
+    float area = 0.0f;
+    for(uint32_t i = 0; i < count; i++) {
+        area += CoreMath::Cross(vertices[i], vertices[(i + 1) % count]);
+    }
+    return area * 0.5f;
+}
+
 
-    return (lIntersect || rIntersect) && (tIntersect || bIntersect);
+static void ReverseVertices(Vector2 *vertices, uint32_t count) {
+    for(uint32_t i = 0; i < count / 2; i++) {
+        std::swap(vertices[i], vertices[count - 1 - i]);
+    }
+}
+
+
+// Counter clockwise hull without duplicate or collinear points (Andrew's monotone chain)
+static void ConvexHull(const Vector2 *points, uint32_t count, std::vector<Vector2> &hull) {
+    std::vector<Vector2> sorted(points, points + count);
+    std::sort(sorted.begin(), sorted.end(), [](const Vector2 &a, const Vector2 &b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), [](const Vector2 &a, const Vector2 &b) {
+        return a.x == b.x && a.y == b.y;
+    }), sorted.end());
+    count = sorted.size();
+    hull.clear();
+    auto turnsLeft = [&](const Vector2 &p) {
+        Vector2 a = hull[hull.size() - 2];
+        Vector2 b = hull.back();
+        return CoreMath::Cross(CoreMath::VectorSubtract(b, a), CoreMath::VectorSubtract(p, a)) > 0.0f;
+    };
+    // lower chain left to right, upper chain back, each ends where the other starts
+    for(uint32_t i = 0; i < count; i++) {
+        while(hull.size() >= 2 && !turnsLeft(sorted[i])) hull.pop_back();
+        hull.push_back(sorted[i]);
+    }
+    size_t lower = hull.size() + 1;
+    for(uint32_t i = count - 1; i-- > 0;) {
+        while(hull.size() >= lower && !turnsLeft(sorted[i])) hull.pop_back();
+        hull.push_back(sorted[i]);
+    }
+    if(hull.size() > 1) hull.pop_back();
+}
+
+
+// Drops the vertex spanning the smallest triangle with its neighbours until
+// the hull fits, the area lost each time is the smallest possible
+static void ReduceHull(std::vector<Vector2> &hull, uint32_t maxCount) {
+    while(hull.size() > maxCount) {
+        uint32_t n = hull.size();
+        uint32_t best = 0;
+        float bestArea = FLT_MAX;
+        for(uint32_t i = 0; i < n; i++) {
+            const Vector2 &prev = hull[(i + n - 1) % n];
+            const Vector2 &next = hull[(i + 1) % n];
+            float area = CoreMath::Cross(CoreMath::VectorSubtract(hull[i], prev), CoreMath::VectorSubtract(next, prev));
+            if(area < bestArea) {
+                bestArea = area;
+                best = i;
+            }
+        }
+        hull.erase(hull.begin() + best);
+    }
+}
+
+
+// Every corner turns the same way as the whole outline, by more than nothing
+static bool IsStrictlyConvex(const Vector2 *points, uint32_t count) {
+    float area = SignedArea(points, count);
+    if(std::fabs(area) <= POLYGON_AREA_EPSILON) return false;
+    for(uint32_t i = 0; i < count; i++) {
+        Vector2 edge = CoreMath::VectorSubtract(points[(i + 1) % count], points[i]);
+        Vector2 next = CoreMath::VectorSubtract(points[(i + 2) % count], points[(i + 1) % count]);
+        if(CoreMath::Cross(edge, next) * area <= 0.0f) return false;
+    }
+    return true;
+}
+
+
+// Point sets that are no valid polygon are logged and replaced by their
+// convex hull, or by a capsule or circle when the hull has no area
+Shape CoreGeometry::CreatePolygon(const Vector2 *points, uint32_t count, float radius) {
+    if(!points || count == 0) {
+        Debug::Logger("CreatePolygon: no points, using a circle of radius ", radius);
+        return CreateCircle(Vector2{0.0f, 0.0f}, radius);
+    }
+
+    std::vector<Vector2> hull(points, points + count);
+    if(count > MAX_POLYGON_VERTICES || count < 3 || !IsStrictlyConvex(points, count)) {
+        if(count <= MAX_POLYGON_VERTICES) Debug::Logger("CreatePolygon: points are no convex polygon, using their hull");
+        ConvexHull(points, count, hull);
+        if(hull.size() > MAX_POLYGON_VERTICES) {
+            Debug::Logger("CreatePolygon: hull reduced to MAX_POLYGON_VERTICES, point count ", count);
+            ReduceHull(hull, MAX_POLYGON_VERTICES);
+        }else if(hull.size() == 2) {
+            Debug::Logger("CreatePolygon: points are collinear, using a capsule");
+            return CreateCapsule(hull[0], hull[1], radius);
+        }else if(hull.size() < 2) {
+            Debug::Logger("CreatePolygon: points are all the same, using a circle");
+            return CreateCircle(hull[0], radius);
+        }
+    }
+
+    Shape shape;
+    shape.type = SHAPE_POLYGON;
+    shape.polygon.count = hull.size();
+    shape.polygon.radius = radius;
+    for(uint32_t i = 0; i < shape.polygon.count; i++) {
+        shape.polygon.vertices[i] = hull[i];
+    }
+    if(SignedArea(shape.polygon.vertices, shape.polygon.count) < 0.0f) {
+        ReverseVertices(shape.polygon.vertices, shape.polygon.count);
+    }
+    ComputePolygonNormals(shape.polygon.vertices, shape.polygon.normals, shape.polygon.count);
+    return shape;
+}
+
+
+/*
+ * Narrowphase
+ * Every shape is first brought to world space as a rounded polygon:
+ * circle = 1 vertex, capsule = 2 vertices, box/polygon = n vertices.
+ * Pairs are dispatched through a table indexed by the shape tags.
+ * */
+
+
+struct WorldPolygon {
+    Vector2 vertices[MAX_POLYGON_VERTICES];
+    Vector2 normals[MAX_POLYGON_VERTICES];
+    uint32_t count;
+    float radius;
+};
+
+
+static const float NARROWPHASE_EPSILON = 1.0e-6f;
+static const float REFERENCE_FACE_TOLERANCE = 0.01f;
+static const float PARALLEL_FACE_TOLERANCE = 0.005f; // 1 + dot of the normals of two parallel faces
+
+
+static void ToWorldPolygon(const Shape &shape, const Affine2D &transform, WorldPolygon *out) {
+    switch(shape.type) {
+        case SHAPE_CIRCLE :
+        {
+            out->count = 1;
+            out->radius = shape.circle.radius;
+            out->vertices[0] = CoreMath::TransformPoint(transform, shape.circle.center);
+            out->normals[0] = Vector2{0.0f, 1.0f};
+        } break;
+        case SHAPE_CAPSULE :
+        {
+            out->count = 2;
+            out->radius = shape.capsule.radius;
+            out->vertices[0] = CoreMath::TransformPoint(transform, shape.capsule.p1);
+            out->vertices[1] = CoreMath::TransformPoint(transform, shape.capsule.p2);
+            ComputePolygonNormals(out->vertices, out->normals, 2);
+        } break;
+        case SHAPE_BOX :
+        {
+            const OrientedBox &box = shape.box;
+            Affine2D local = CoreMath::CreateAffine2D(box.center, box.halfExtents, box.rotation);
+            Affine2D world = CoreMath::Multiply(transform, local);
+            const Vector2 corners[4] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+            out->count = 4;
+            out->radius = 0.0f;
+            for(uint32_t i = 0; i < 4; i++) {
+                out->vertices[i] = CoreMath::TransformPoint(world, corners[i]);
+            }
+            if(world.m11 * world.m22 - world.m12 * world.m21 < 0.0f) {
+                ReverseVertices(out->vertices, 4);
+            }
+            ComputePolygonNormals(out->vertices, out->normals, 4);
+        } break;
+        case SHAPE_POLYGON :
+        {
+            out->count = shape.polygon.count;
+            out->radius = shape.polygon.radius;
+            for(uint32_t i = 0; i < out->count; i++) {
+                out->vertices[i] = CoreMath::TransformPoint(transform, shape.polygon.vertices[i]);
+            }
+            // mirroring transforms flip the winding
+            if(transform.m11 * transform.m22 - transform.m12 * transform.m21 < 0.0f) {
+                ReverseVertices(out->vertices, out->count);
+            }
+            ComputePolygonNormals(out->vertices, out->normals, out->count);
+        } break;
+        default : 
+        {
+            out->count = 0;
+            out->radius = 0.0f;
+        } break;
+    }
+}
+
+
+static Vector2 ClosestPointOnSegment(const Vector2 &p, const Vector2 &a, const Vector2 &b) {
+    Vector2 ab = CoreMath::VectorSubtract(b, a);
+    float lengthSq = CoreMath::Dot(ab, ab);
+    if(lengthSq < NARROWPHASE_EPSILON) return a;
+    float t = CoreMath::Dot(CoreMath::VectorSubtract(p, a), ab) / lengthSq;
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    return CoreMath::VectorAdd(a, CoreMath::VectorMul(ab, t));
+}
+
+
+// Closest points c1 on p1-q1 and c2 on p2-q2 (Ericson, Real-Time Collision Detection 5.1.9)
+static float ClosestPointsSegments(
+    const Vector2 &p1, const Vector2 &q1,
+    const Vector2 &p2, const Vector2 &q2,
+    Vector2 *c1, Vector2 *c2
+) {
+    Vector2 d1 = CoreMath::VectorSubtract(q1, p1);
+    Vector2 d2 = CoreMath::VectorSubtract(q2, p2);
+    Vector2 r = CoreMath::VectorSubtract(p1, p2);
+    float a = CoreMath::Dot(d1, d1);
+    float e = CoreMath::Dot(d2, d2);
+    float f = CoreMath::Dot(d2, r);
+    float s = 0.0f;
+    float t = 0.0f;
+
+    if(a <= NARROWPHASE_EPSILON && e <= NARROWPHASE_EPSILON) {
+        s = t = 0.0f;
+    }else if(a <= NARROWPHASE_EPSILON) {
+        t = std::min(std::max(f / e, 0.0f), 1.0f);
+    }else{
+        float c = CoreMath::Dot(d1, r);
+        if(e <= NARROWPHASE_EPSILON) {
+            s = std::min(std::max(-c / a, 0.0f), 1.0f);
+        }else{
+            float b = CoreMath::Dot(d1, d2);
+            float denom = a * e - b * b;
+            s = denom != 0.0f ? std::min(std::max((b * f - c * e) / denom, 0.0f), 1.0f) : 0.0f;
+            t = (b * s + f) / e;
+            if(t < 0.0f) {
+                t = 0.0f;
+                s = std::min(std::max(-c / a, 0.0f), 1.0f);
+            }else if(t > 1.0f) {
+                t = 1.0f;
+                s = std::min(std::max((b - c) / a, 0.0f), 1.0f);
+            }
+        }
+    }
+
+    *c1 = CoreMath::VectorAdd(p1, CoreMath::VectorMul(d1, s));
+    *c2 = CoreMath::VectorAdd(p2, CoreMath::VectorMul(d2, t));
+    Vector2 d = CoreMath::VectorSubtract(*c2, *c1);
+    return CoreMath::Dot(d, d);
+}
+
+
+// Closest points between the edges of both cores, circles and capsules are
+// single points and segments. Returns the squared distance.
+static float ClosestFeatures(const WorldPolygon &a, const WorldPolygon &b, Vector2 *pointA, Vector2 *pointB) {
+    float best = FLT_MAX;
+    *pointA = a.vertices[0];
+    *pointB = b.vertices[0];
+    for(uint32_t i = 0; i < a.count; i++) {
+        for(uint32_t j = 0; j < b.count; j++) {
+            Vector2 ca, cb;
+            float d = ClosestPointsSegments(
+                a.vertices[i], a.vertices[(i + 1) % a.count],
+                b.vertices[j], b.vertices[(j + 1) % b.count],
+                &ca, &cb
+                );
+            if(d < best) {
+                best = d;
+                *pointA = ca;
+                *pointB = cb;
+            }
+        }
+    }
+    return best;
+}
+
+
+// Single contact between two points on the cores of A and B with their radii
+static bool ContactFromClosestPoints(
+    const Vector2 &pointA, float radiusA,
+    const Vector2 &pointB, float radiusB,
+    const Vector2 &fallbackNormal,
+    Manifold *manifold
+) {
+    Vector2 d = CoreMath::VectorSubtract(pointB, pointA);
+    float distanceSq = CoreMath::Dot(d, d);
+    float radius = radiusA + radiusB;
+    if(distanceSq > radius * radius) return false;
+
+    float distance = std::sqrt(distanceSq);
+    Vector2 normal = distance > NARROWPHASE_EPSILON
+        ? CoreMath::VectorMul(d, 1.0f / distance)
+        : fallbackNormal;
+    Vector2 surfaceA = CoreMath::VectorAdd(pointA, CoreMath::VectorMul(normal, radiusA));
+    Vector2 surfaceB = CoreMath::VectorSubtract(pointB, CoreMath::VectorMul(normal, radiusB));
+
+    manifold->normal = normal;
+    manifold->points[0] = CoreMath::VectorMul(CoreMath::VectorAdd(surfaceA, surfaceB), 0.5f);
+    manifold->depths[0] = radius - distance;
+    manifold->pointCount = 1;
+    return true;
+}
+
+
+static void FlipManifold(Manifold *manifold) {
+    manifold->normal = CoreMath::VectorMul(manifold->normal, -1.0f);
+}
+
+
+static bool CollideCircles(const WorldPolygon &a, const WorldPolygon &b, Manifold *manifold) {
+    return ContactFromClosestPoints(
+        a.vertices[0], a.radius,
+        b.vertices[0], b.radius,
+        Vector2{0.0f, 1.0f},
+        manifold
+        );
+}
+
+
+static bool CollideCapsuleAndCircle(const WorldPolygon &a, const WorldPolygon &b, Manifold *manifold) {
+    Vector2 closest = ClosestPointOnSegment(b.vertices[0], a.vertices[0], a.vertices[1]);
+    return ContactFromClosestPoints(
+        closest, a.radius,
+        b.vertices[0], b.radius,
+        a.normals[0],
+        manifold
+        );
+}
+
+
+static bool CollideCircleAndCapsule(const WorldPolygon &a, const WorldPolygon &b, Manifold *manifold) {
+    if(!CollideCapsuleAndCircle(b, a, manifold)) return false;
+    FlipManifold(manifold);
+    return true;
+}
+
+
+static bool CollideCapsules(const WorldPolygon &a, const WorldPolygon &b, Manifold *manifold) {
+    Vector2 closestA, closestB;
+    ClosestPointsSegments(
+        a.vertices[0], a.vertices[1],
+        b.vertices[0], b.vertices[1],
+        &closestA, &closestB
+        );
+    // crossing segments, push along the normal of A facing B
+    Vector2 fallback = a.normals[0];
+    Vector2 centerB = CoreMath::VectorMul(CoreMath::VectorAdd(b.vertices[0], b.vertices[1]), 0.5f);
+    if(CoreMath::Dot(fallback, CoreMath::VectorSubtract(centerB, a.vertices[0])) < 0.0f) {
+        fallback = CoreMath::VectorMul(fallback, -1.0f);
+    }
+    return ContactFromClosestPoints(
+        closestA, a.radius,
+        closestB, b.radius,
+        fallback,
+        manifold
+        );
+}
+
+
+// Box2D style polygon vs circle, handles rounded polygons
+static bool CollidePolygonAndCircle(const WorldPolygon &a, const WorldPolygon &b, Manifold *manifold) {
+    const Vector2 &center = b.vertices[0];
+    float radius = a.radius + b.radius;
+
+    uint32_t normalIndex = 0;
+    float separation = -FLT_MAX;
+    for(uint32_t i = 0; i < a.count; i++) {
+        float s = CoreMath::Dot(a.normals[i], CoreMath::VectorSubtract(center, a.vertices[i]));
+        if(s > radius) return false;
+        if(s > separation) {
+            separation = s;
+            normalIndex = i;
+        }
+    }
+
+    const Vector2 &v1 = a.vertices[normalIndex];
+    const Vector2 &v2 = a.vertices[(normalIndex + 1) % a.count];
+    float u1 = CoreMath::Dot(CoreMath::VectorSubtract(center, v1), CoreMath::VectorSubtract(v2, v1));
+    float u2 = CoreMath::Dot(CoreMath::VectorSubtract(center, v2), CoreMath::VectorSubtract(v1, v2));
+
+    // vertex regions, only reachable when the center is outside the core polygon
+    if(separation > NARROWPHASE_EPSILON && u1 <= 0.0f) {
+        return ContactFromClosestPoints(v1, a.radius, center, b.radius, a.normals[normalIndex], manifold);
+    }
+    if(separation > NARROWPHASE_EPSILON && u2 <= 0.0f) {
+        return ContactFromClosestPoints(v2, a.radius, center, b.radius, a.normals[normalIndex], manifold);
+    }
+
+    // face region
+    Vector2 normal = a.normals[normalIndex];
+    Vector2 onFace = CoreMath::VectorSubtract(center, CoreMath::VectorMul(normal, separation));
+    Vector2 surfaceA = CoreMath::VectorAdd(onFace, CoreMath::VectorMul(normal, a.radius));
+    Vector2 surfaceB = CoreMath::VectorSubtract(center, CoreMath::VectorMul(normal, b.radius));
+    manifold->normal = normal;
+    manifold->points[0] = CoreMath::VectorMul(CoreMath::VectorAdd(surfaceA, surfaceB), 0.5f);
+    manifold->depths[0] = radius - separation;
+    manifold->pointCount = 1;
+    return true;
+}
+
+
+static bool CollideCircleAndPolygon(const WorldPolygon &a, const WorldPolygon &b, Manifold *manifold) {
+    if(!CollidePolygonAndCircle(b, a, manifold)) return false;
+    FlipManifold(manifold);
+    return true;
+}
+
+
+// Largest separation of poly2 along the face normals of poly1
+static float FindMaxSeparation(const WorldPolygon &poly1, const WorldPolygon &poly2, uint32_t *edgeIndex) {
+    float maxSeparation = -FLT_MAX;
+    uint32_t bestIndex = 0;
+    for(uint32_t i = 0; i < poly1.count; i++) {
+        const Vector2 &n = poly1.normals[i];
+        const Vector2 &v = poly1.vertices[i];
+        float si = FLT_MAX;
+        for(uint32_t j = 0; j < poly2.count; j++) {
+            si = std::min(si, CoreMath::Dot(n, CoreMath::VectorSubtract(poly2.vertices[j], v)));
+        }
+        if(si > maxSeparation) {
+            maxSeparation = si;
+            bestIndex = i;
+        }
+    }
+    *edgeIndex = bestIndex;
+    return maxSeparation;
+}
+
+
+// Keeps the part of the segment behind the plane dot(normal, v) = offset
+static uint32_t ClipSegmentToLine(Vector2 out[2], const Vector2 in[2], const Vector2 &normal, float offset) {
+    uint32_t count = 0;
+    float distance0 = CoreMath::Dot(normal, in[0]) - offset;
+    float distance1 = CoreMath::Dot(normal, in[1]) - offset;
+    if(distance0 <= 0.0f) out[count++] = in[0];
+    if(distance1 <= 0.0f) out[count++] = in[1];
+    if(distance0 * distance1 < 0.0f) {
+        float t = distance0 / (distance0 - distance1);
+        out[count++] = CoreMath::VectorAdd(in[0], CoreMath::VectorMul(CoreMath::VectorSubtract(in[1], in[0]), t));
+    }
+    return count;
+}
+
+
+// Clips the incident face of poly2 against the side planes of the reference
+// face edge1 of poly1, false when fewer than two points stay inside them
+static bool ClipFaces(
+    const WorldPolygon &poly1, const WorldPolygon &poly2,
+    uint32_t edge1, uint32_t incident, bool flip,
+    Manifold *manifold
+) {
+    float totalRadius = poly1.radius + poly2.radius;
+    Vector2 normal1 = poly1.normals[edge1];
+    Vector2 incidentEdge[2] = {
+        poly2.vertices[incident],
+        poly2.vertices[(incident + 1) % poly2.count]
+    };
+
+    const Vector2 &v11 = poly1.vertices[edge1];
+    const Vector2 &v12 = poly1.vertices[(edge1 + 1) % poly1.count];
+    Vector2 tangent = CoreMath::Normalize(CoreMath::VectorSubtract(v12, v11));
+    float frontOffset = CoreMath::Dot(normal1, v11);
+    float sideOffset1 = -CoreMath::Dot(tangent, v11) + totalRadius;
+    float sideOffset2 = CoreMath::Dot(tangent, v12) + totalRadius;
+
+    Vector2 clip1[3];
+    Vector2 clip2[3];
+    if(ClipSegmentToLine(clip1, incidentEdge, CoreMath::VectorMul(tangent, -1.0f), sideOffset1) < 2) return false;
+    if(ClipSegmentToLine(clip2, clip1, tangent, sideOffset2) < 2) return false;
+
+    manifold->normal = flip ? CoreMath::VectorMul(normal1, -1.0f) : normal1;
+    manifold->pointCount = 0;
+    for(uint32_t i = 0; i < 2; i++) {
+        float separation = CoreMath::Dot(normal1, clip2[i]) - frontOffset;
+        if(separation <= totalRadius) {
+            // halfway between the reference and incident surfaces
+            float offset = (poly1.radius - separation - poly2.radius) * 0.5f;
+            uint32_t index = manifold->pointCount++;
+            manifold->points[index] = CoreMath::VectorAdd(clip2[i], CoreMath::VectorMul(normal1, offset));
+            manifold->depths[index] = totalRadius - separation;
+        }
+    }
+    return manifold->pointCount > 0;
+}
+
+
+// SAT + reference face clipping, works for any pair with 2+ vertices
+// so it also covers capsule vs polygon
+static bool CollidePolygons(const WorldPolygon &a, const WorldPolygon &b, Manifold *manifold) {
+    float totalRadius = a.radius + b.radius;
+
+    uint32_t edgeA = 0;
+    float separationA = FindMaxSeparation(a, b, &edgeA);
+    if(separationA > totalRadius) return false;
+
+    uint32_t edgeB = 0;
+    float separationB = FindMaxSeparation(b, a, &edgeB);
+    if(separationB > totalRadius) return false;
+
+    const WorldPolygon *poly1; // reference
+    const WorldPolygon *poly2; // incident
+    uint32_t edge1;
+    bool flip;
+    if(separationB > separationA + REFERENCE_FACE_TOLERANCE) {
+        poly1 = &b;
+        poly2 = &a;
+        edge1 = edgeB;
+        flip = true;
+    }else{
+        poly1 = &a;
+        poly2 = &b;
+        edge1 = edgeA;
+        flip = false;
+    }
+
+    // incident edge, the most anti-parallel face of poly2
+    Vector2 normal1 = poly1->normals[edge1];
+    uint32_t incident = 0;
+    float minDot = FLT_MAX;
+    for(uint32_t i = 0; i < poly2->count; i++) {
+        float d = CoreMath::Dot(normal1, poly2->normals[i]);
+        if(d < minDot) {
+            minDot = d;
+            incident = i;
+        }
+    }
+
+    if(separationA <= 0.0f && separationB <= 0.0f) {
+        return ClipFaces(*poly1, *poly2, edge1, incident, flip, manifold);
+    }
+
+    // cores are apart but the rounded skins touch. Parallel faces, a capsule
+    // lying on a box, keep both clipped points, anything else the closest features.
+    if(minDot <= PARALLEL_FACE_TOLERANCE - 1.0f && ClipFaces(*poly1, *poly2, edge1, incident, flip, manifold)) {
+        return true;
+    }
+    Vector2 bestA, bestB;
+    ClosestFeatures(a, b, &bestA, &bestB);
+    Vector2 fallback = separationA >= separationB
+        ? a.normals[edgeA]
+        : CoreMath::VectorMul(b.normals[edgeB], -1.0f);
+    return ContactFromClosestPoints(bestA, a.radius, bestB, b.radius, fallback, manifold);
+}
+
+
+typedef bool (*CollideFunction)(const WorldPolygon&, const WorldPolygon&, Manifold*);
+
+static const CollideFunction collideTable[SHAPE_TYPE_COUNT][SHAPE_TYPE_COUNT] = {
+    //              CIRCLE                      CAPSULE                     BOX                         POLYGON
+    /* CIRCLE  */ { CollideCircles,             CollideCircleAndCapsule,    CollideCircleAndPolygon,    CollideCircleAndPolygon },
+    /* CAPSULE */ { CollideCapsuleAndCircle,    CollideCapsules,            CollidePolygons,            CollidePolygons },
+    /* BOX     */ { CollidePolygonAndCircle,    CollidePolygons,            CollidePolygons,            CollidePolygons },
+    /* POLYGON */ { CollidePolygonAndCircle,    CollidePolygons,            CollidePolygons,            CollidePolygons },
+};
+
+
+BoundingRect CoreGeometry::ComputeAABB(const Shape &shape, const Affine2D &transform) {
+    WorldPolygon poly;
+    ToWorldPolygon(shape, transform, &poly);
+    BoundingRect aabb;
+    if(poly.count == 0) {
+        aabb.bound = {transform.m13, transform.m23, transform.m13, transform.m23};
+        return aabb;
+    }
+    Vector2 min = poly.vertices[0];
+    Vector2 max = poly.vertices[0];
+    for(uint32_t i = 1; i < poly.count; i++) {
+        min.x = std::min(min.x, poly.vertices[i].x);
+        min.y = std::min(min.y, poly.vertices[i].y);
+        max.x = std::max(max.x, poly.vertices[i].x);
+        max.y = std::max(max.y, poly.vertices[i].y);
+    }
+    aabb.bound = {min.x - poly.radius, min.y - poly.radius, max.x + poly.radius, max.y + poly.radius};
+    return aabb;
+}
+
+
+bool CoreGeometry::Collide(
+    const Shape &a, const Affine2D &transformA,
+    const Shape &b, const Affine2D &transformB,
+    Manifold *manifold
+) {
+    if(a.type >= SHAPE_TYPE_COUNT || b.type >= SHAPE_TYPE_COUNT) return false;
+    WorldPolygon worldA;
+    WorldPolygon worldB;
+    ToWorldPolygon(a, transformA, &worldA);
+    ToWorldPolygon(b, transformB, &worldB);
+    return collideTable[a.type][b.type](worldA, worldB, manifold);
+}
+
+
+float CoreGeometry::Distance(
+    const Shape &a, const Affine2D &transformA,
+    const Shape &b, const Affine2D &transformB,
+    Manifold *manifold
+) {
+    if(a.type >= SHAPE_TYPE_COUNT || b.type >= SHAPE_TYPE_COUNT) return FLT_MAX;
+    WorldPolygon worldA;
+    WorldPolygon worldB;
+    ToWorldPolygon(a, transformA, &worldA);
+    ToWorldPolygon(b, transformB, &worldB);
+    Vector2 pointA, pointB;
+    float distance = std::sqrt(ClosestFeatures(worldA, worldB, &pointA, &pointB));
+    // A face normal explains the distance whenever the closest feature of one
+    // core is a face, it stays exact while the closest points lose precision
+    // as the cores come close. Points only give the direction between two
+    // vertices, two circles on one center have none, a zero normal closes at no speed.
+    uint32_t edgeA = 0;
+    uint32_t edgeB = 0;
+    float separationA = worldA.count >= 2 ? FindMaxSeparation(worldA, worldB, &edgeA) : -FLT_MAX;
+    float separationB = worldB.count >= 2 ? FindMaxSeparation(worldB, worldA, &edgeB) : -FLT_MAX;
+    Vector2 normal = {0.0f, 0.0f};
+    if(std::max(separationA, separationB) + REFERENCE_FACE_TOLERANCE >= distance) {
+        normal = separationA >= separationB
+            ? worldA.normals[edgeA]
+            : CoreMath::VectorMul(worldB.normals[edgeB], -1.0f);
+    }else if(distance > NARROWPHASE_EPSILON) {
+        normal = CoreMath::VectorMul(CoreMath::VectorSubtract(pointB, pointA), 1.0f / distance);
+    }
+    Vector2 surfaceA = CoreMath::VectorAdd(pointA, CoreMath::VectorMul(normal, worldA.radius));
+    Vector2 surfaceB = CoreMath::VectorSubtract(pointB, CoreMath::VectorMul(normal, worldB.radius));
+    float gap = distance - worldA.radius - worldB.radius;
+    manifold->normal = normal;
+    manifold->points[0] = CoreMath::VectorMul(CoreMath::VectorAdd(surfaceA, surfaceB), 0.5f);
+    manifold->depths[0] = -gap;
+    manifold->pointCount = 1;
+    return gap;
+}
+
+
+/*
+ * Raycast
+ * The rounded polygon is the union of its edges pushed out by the radius
+ * and a circle on every vertex, the first entry over all of them is the hit.
+ * */
+
+
+static bool RaycastCircle(
+    const Vector2 &center, float radius,
+    const Vector2 &origin, const Vector2 &direction,
+    float *t, Vector2 *normal
+) {
+    Vector2 m = CoreMath::VectorSubtract(origin, center);
+    float c = CoreMath::Dot(m, m) - radius * radius;
+    if(c <= 0.0f) return false; // origin inside
+    float b = CoreMath::Dot(m, direction);
+    if(b >= 0.0f) return false; // pointing away
+    float discriminant = b * b - c;
+    if(discriminant < 0.0f) return false;
+    *t = -b - std::sqrt(discriminant);
+    Vector2 point = CoreMath::VectorAdd(origin, CoreMath::VectorMul(direction, *t));
+    *normal = CoreMath::Normalize(CoreMath::VectorSubtract(point, center));
+    return true;
+}
+
+
+bool CoreGeometry::Raycast(
+    const Shape &shape, const Affine2D &transform,
+    const Vector2 &origin, const Vector2 &direction, float maxDistance,
+    float *distance, Vector2 *normal
+) {
+    if(shape.type >= SHAPE_TYPE_COUNT) return false;
+    WorldPolygon poly;
+    ToWorldPolygon(shape, transform, &poly);
+
+    float best = maxDistance;
+    bool hit = false;
+
+    // a single vertex has no edges, it is only its circle
+    uint32_t edgeCount = poly.count > 1 ? poly.count : 0;
+    for(uint32_t i = 0; i < edgeCount; i++) {
+        const Vector2 &n = poly.normals[i];
+        float denominator = CoreMath::Dot(n, direction);
+        if(denominator >= 0.0f) continue; // only entering faces
+        Vector2 offset = CoreMath::VectorMul(n, poly.radius);
+        Vector2 v1 = CoreMath::VectorAdd(poly.vertices[i], offset);
+        Vector2 v2 = CoreMath::VectorAdd(poly.vertices[(i + 1) % poly.count], offset);
+        float numerator = CoreMath::Dot(n, CoreMath::VectorSubtract(v1, origin));
+        float t = numerator / denominator;
+        if(t < 0.0f || t > best) continue;
+        Vector2 point = CoreMath::VectorAdd(origin, CoreMath::VectorMul(direction, t));
+        Vector2 edge = CoreMath::VectorSubtract(v2, v1);
+        float u = CoreMath::Dot(CoreMath::VectorSubtract(point, v1), edge);
+        if(u < 0.0f || u > CoreMath::Dot(edge, edge)) continue;
+        best = t;
+        *normal = n;
+        hit = true;
+    }
+
+    if(poly.radius > 0.0f) {
+        for(uint32_t i = 0; i < poly.count; i++) {
+            float t;
+            Vector2 n;
+            if(RaycastCircle(poly.vertices[i], poly.radius, origin, direction, &t, &n) && t <= best) {
+                best = t;
+                *normal = n;
+                hit = true;
+            }
+        }
+    }
 
+    if(hit) *distance = best;
+    return hit;
 }
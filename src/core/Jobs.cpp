@@ -0,0 +1,125 @@
+#include <core/Jobs.h>
+#include <core/CoreGlobals.h>
+#include <exception>
+#include <utils/Debug.h>
+
+using namespace CoreJobs;
+
+CoreJobs::JobSystem* CoreGlobals::jobSystem = nullptr;
+
+
+static void RunBatches(Job *job) {
+    uint32_t batch;
+    while((batch = job->nextBatch.fetch_add(1)) < job->batchCount) {
+        uint32_t begin = batch * job->batchSize;
+        uint32_t end = std::min(begin + job->batchSize, job->count);
+        job->function(batch, begin, end, job->context);
+        job->pendingBatches.fetch_sub(1);
+    }
+}
+
+
+static void WorkerLoop(JobSystem *system) {
+    uint64_t seen = 0;
+    while(true) {
+        Job *job;
+        {
+            std::unique_lock<std::mutex> lock(system->mutex);
+            system->wake.wait(lock, [&]{ return system->quit || (system->current && system->generation != seen); });
+            if(system->quit) return;
+            seen = system->generation;
+            job = system->current;
+            // the job lives on the caller stack, it waits for every worker holding it
+            job->activeWorkers.fetch_add(1);
+        }
+        RunBatches(job);
+        {
+            std::lock_guard<std::mutex> lock(system->mutex);
+            job->activeWorkers.fetch_sub(1);
+        }
+        system->done.notify_all();
+    }
+}
+
+
+bool CoreJobs::JobsMake(uint32_t workerCount) {
+    try{
+        if(workerCount == 0) {
+            uint32_t hardware = std::thread::hardware_concurrency();
+            workerCount = hardware > 1 ? hardware - 1 : 0;
+        }
+        JobSystem *system = new JobSystem();
+        for(uint32_t i = 0; i < workerCount; i++) {
+            system->workers.emplace_back(WorkerLoop, system);
+        }
+        CoreGlobals::jobSystem = system;
+        Debug::Logger("CoreJobs:: workers ", workerCount);
+        return true;
+    }catch (std::exception &e){
+        return false;
+    }
+}
+
+
+bool CoreJobs::JobsDestroy() {
+    JobSystem *system = CoreGlobals::jobSystem;
+    if(!system) return true;
+    try{
+        {
+            std::lock_guard<std::mutex> lock(system->mutex);
+            system->quit = true;
+        }
+        system->wake.notify_all();
+        for(std::thread &worker : system->workers) {
+            worker.join();
+        }
+        delete system;
+        CoreGlobals::jobSystem = nullptr;
+        return true;
+    }catch (std::exception &e){
+        return false;
+    }
+}
+
+
+uint32_t CoreJobs::WorkerCount() {
+    return CoreGlobals::jobSystem ? (uint32_t) CoreGlobals::jobSystem->workers.size() : 0;
+}
+
+
+void CoreJobs::ParallelFor(uint32_t count, uint32_t batchSize, JobFunction function, void *context) {
+    if(count == 0) return;
+    if(batchSize == 0) batchSize = 1;
+    uint32_t batchCount = BatchCount(count, batchSize);
+    JobSystem *system = CoreGlobals::jobSystem;
+
+    if(!system || system->workers.empty() || batchCount == 1) {
+        for(uint32_t batch = 0; batch < batchCount; batch++) {
+            uint32_t begin = batch * batchSize;
+            function(batch, begin, std::min(begin + batchSize, count), context);
+        }
+        return;
+    }
+
+    Job job;
+    job.function = function;
+    job.context = context;
+    job.count = count;
+    job.batchSize = batchSize;
+    job.batchCount = batchCount;
+    job.nextBatch = 0;
+    job.pendingBatches = batchCount;
+    job.activeWorkers = 0;
+    {
+        std::lock_guard<std::mutex> lock(system->mutex);
+        system->current = &job;
+        system->generation++;
+    }
+    system->wake.notify_all();
+
+    RunBatches(&job);
+
+    std::unique_lock<std::mutex> lock(system->mutex);
+    system->done.wait(lock, [&]{ return job.pendingBatches == 0 && job.activeWorkers == 0; });
+    system->current = nullptr;
+}
@@ -1,15 +1,44 @@
 #include <core/Physics.h>
 #include <core/CoreGlobals.h>
+#include <core/Jobs.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
 #include <exception>
+#include <type_traits>
 #include <utils/Debug.h>
 
 using namespace CorePhysics;
 
 CorePhysics::World* CoreGlobals::physicsWorld = nullptr;
 
-double stepAccumulateTime = 0.0f;
-double targetStepTime     = 1/60.0f;  // set this to follow engine target frame rate
-double tolerance          = targetStepTime * 0.2;  // 20% fluctuation tolerance
+// Work split of the parallel passes. Batches only depend on these sizes,
+// never on the worker count, which keeps every step bit identical
+// for any number of threads.
+const uint32_t BOUNDS_BATCH_SIZE    = 256;
+const uint32_t PAIR_BATCH_SIZE      = 64;   // grid cells or moved tree proxies
+const uint32_t CONTACT_BATCH_SIZE   = 128;
+const uint32_t ISLAND_BATCH_SIZE    = 16;
+const uint32_t INTEGRATE_BATCH_SIZE = 1024; // even, SIMD lanes hold two bodies
+const uint32_t BULLET_BATCH_SIZE    = 4;
+
+// Spatial grid
+const uint32_t MAX_GRID_CELLS = 64;          // cells a collider may span before it is kept out of the grid
+const float CELL_COORD_LIMIT = 536870912.0f; // 2^29, cell coordinates are clamped so spans fit in 32 bits
+const uint32_t MIN_GRID_SLOTS = 64;
+
+// Contact solver tuning, distances in world units
+const float BAUMGARTE = 0.2f;              // share of the penetration removed per step
+const float LINEAR_SLOP = 0.5f;            // penetration left alone so contacts persist
+const float RESTITUTION_THRESHOLD = 1.0f;  // slower impacts do not bounce
+const float CONTACT_MATCH_DISTANCE = 2.0f; // drift that still counts as the same point
+const float DEFAULT_FRICTION = 0.2f;
+
+// Time of impact
+const uint32_t MAX_TOI_SUBSTEPS = 4;    // impacts handled per bullet and step
+const uint32_t TOI_ITERATIONS = 20;     // conservative advancement steps per bullet and candidate
+const float TOI_TARGET = 0.1f;          // gap at which a sweep counts as an impact
 
 
 bool CorePhysics::WorldMake() {
@@ -24,9 +53,8 @@ bool CorePhysics::WorldMake() {
 
 bool CorePhysics::WorldDestroy() {
     try{
-        for(auto &collider : CoreGlobals::physicsWorld->colliders) {
-            delete collider;
-        }
+        delete CoreGlobals::physicsWorld;
+        CoreGlobals::physicsWorld = nullptr;
         return true;
     }catch (std::exception &e){
         return false;
@@ -34,95 +62,2111 @@ bool CorePhysics::WorldDestroy() {
 }
 
 
-BoxCollider* CorePhysics::CreateBoxCollider(GameObject::Empty *emptyObject, CoreGeometry::BoundingRect &boundingRect) {
-    BoxCollider *newCollider = new BoxCollider();
-    newCollider->type = CorePhysics::ColliderType::BOX_COLLIDER;
-    newCollider->visible = true;
-    newCollider->transform = emptyObject->transform;
-    newCollider->AABB = boundingRect;
-    newCollider->owner = emptyObject;
-    return newCollider;
+/*
+ * Colliders
+ * */
+
+
+static inline uint32_t ColliderCount(const World *world) {
+    return (uint32_t) world->positions.size();
+}
+
+
+static bool PairLess(const ColliderPair &a, const ColliderPair &b) {
+    return a.a < b.a || (a.a == b.a && a.b < b.b);
+}
+
+
+static inline bool IsAwakeDynamic(uint32_t flags) {
+    return (flags & (COLLIDER_ACTIVE | COLLIDER_STATIC | COLLIDER_SLEEPING)) == COLLIDER_ACTIVE;
+}
+
+
+static inline bool ShouldCollide(const World *world, uint32_t a, uint32_t b) {
+    return (world->categories[a] & world->masks[b]) && (world->categories[b] & world->masks[a]);
+}
+
+
+// both active and at least one of them can move
+static inline bool CanTouch(uint32_t flagsA, uint32_t flagsB) {
+    return (flagsA & flagsB & COLLIDER_ACTIVE) && (IsAwakeDynamic(flagsA) || IsAwakeDynamic(flagsB));
+}
+
+
+// Queues the island of a sleeping collider, the wake pass wakes it as a whole
+static void RequestWake(World *world, uint32_t index) {
+    world->sleepTimers[index] = 0.0f;
+    if(world->flags[index] & COLLIDER_SLEEPING) {
+        world->wakeIslands.push_back(world->sleepIslands[index]);
+    }
+}
+
+
+// Dense index of a handle from game code, INVALID_INDEX once it went stale
+static inline uint32_t DenseIndex(const World *world, ColliderHandle handle) {
+    if(handle.index >= world->denseIndex.size()) return INVALID_INDEX;
+    if(world->generations[handle.index] != handle.generation) return INVALID_INDEX;
+    return world->denseIndex[handle.index];
+}
+
+
+// Dense index of a slot the world kept itself, it may have been freed since
+static inline uint32_t DenseIndex(const World *world, uint32_t slot) {
+    if(slot >= world->denseIndex.size()) return INVALID_INDEX;
+    return world->denseIndex[slot];
+}
+
+
+static inline ColliderHandle HandleAt(const World *world, uint32_t index) {
+    uint32_t slot = world->handles[index];
+    return ColliderHandle{slot, world->generations[slot]};
+}
+
+
+// Keeps the awake list in step with the flags of one collider
+static void UpdateAwake(World *world, uint32_t index) {
+    uint32_t handle = world->handles[index];
+    if(handle >= world->awakeSlots.size()) world->awakeSlots.resize(handle + 1, INVALID_INDEX);
+    uint32_t slot = world->awakeSlots[handle];
+    bool awake = IsAwakeDynamic(world->flags[index]);
+    if(awake && slot == INVALID_INDEX) {
+        world->awakeSlots[handle] = world->awakeHandles.size();
+        world->awakeHandles.push_back(handle);
+    }else if(!awake && slot != INVALID_INDEX) {
+        uint32_t last = world->awakeHandles.back();
+        world->awakeHandles[slot] = last;
+        world->awakeSlots[last] = slot;
+        world->awakeHandles.pop_back();
+        world->awakeSlots[handle] = INVALID_INDEX;
+    }
+}
+
+
+// Bounds of a static or sleeping collider are only recomputed once marked
+static void MarkDirty(World *world, uint32_t index) {
+    if(!(world->flags[index] & COLLIDER_DIRTY)) world->dirtyHandles.push_back(world->handles[index]);
+    world->flags[index] |= COLLIDER_DIRTY;
+    world->boundsDirty = true;
+}
+
+
+// Awake and dirty lists from the flags, after the flags were replaced as a whole
+static void RebuildFlagLists(World *world) {
+    world->awakeHandles.clear();
+    world->awakeSlots.assign(world->denseIndex.size(), INVALID_INDEX);
+    world->dirtyHandles.clear();
+    world->sleptHandles.clear();
+    uint32_t n = ColliderCount(world);
+    for(uint32_t i = 0; i < n; i++) {
+        UpdateAwake(world, i);
+        if(world->flags[i] & COLLIDER_DIRTY) world->dirtyHandles.push_back(world->handles[i]);
+    }
+}
+
+
+static Vector2 OwnerPosition(GameObject::Empty *owner) {
+    return Vector2{owner->transform.World.m13, owner->transform.World.m23};
+}
+
+
+ColliderHandle CorePhysics::CreateCollider(
+    GameObject::Empty *gameObject,
+    const CoreGeometry::Shape &shape
+) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t slot;
+    if(world->freeHandles.empty()) {
+        slot = (uint32_t) world->denseIndex.size();
+        world->denseIndex.push_back(INVALID_INDEX);
+        world->generations.push_back(1);
+    }else{
+        slot = world->freeHandles.back();
+        world->freeHandles.pop_back();
+    }
+
+    Vector2 position = gameObject ? OwnerPosition(gameObject) : Vector2{0.0f, 0.0f};
+    world->denseIndex[slot] = ColliderCount(world);
+    world->positions.push_back(position);
+    world->velocities.push_back(Vector2{0.0f, 0.0f});
+    world->inverseMasses.push_back(1.0f);
+    world->frictions.push_back(DEFAULT_FRICTION);
+    world->restitutions.push_back(0.0f);
+    world->previousPositions.push_back(position);
+    world->syncPositions.push_back(position);
+    world->syncLocals.push_back(gameObject
+        ? Vector2{gameObject->transform.pos.x, gameObject->transform.pos.y}
+        : Vector2{0.0f, 0.0f});
+    world->bounds.push_back(CoreGeometry::BoundingRect{});
+    world->shapes.push_back(shape);
+    world->flags.push_back(COLLIDER_ACTIVE | COLLIDER_VISIBLE | COLLIDER_DIRTY);
+    world->sleepTimers.push_back(0.0f);
+    world->sleepIslands.push_back(slot);
+    CollisionFilter filter = gameObject ? gameObject->collisionFilter : CollisionFilter{};
+    world->categories.push_back(filter.categories);
+    world->masks.push_back(filter.mask);
+    world->owners.push_back(gameObject);
+    world->handles.push_back(slot);
+    world->dirtyHandles.push_back(slot);
+    UpdateAwake(world, world->denseIndex[slot]);
+    world->boundsDirty = true;
+    world->structureVersion++;
+    ColliderHandle handle = {slot, world->generations[slot]};
+    if(gameObject) gameObject->collider = handle;
+    return handle;
+}
+
+
+ColliderHandle CorePhysics::CreateBoxCollider(GameObject::Empty *emptyObject, const CoreGeometry::BoundingRect &boundingRect) {
+    return CreateCollider(emptyObject, CoreGeometry::CreateBox(Vector2{
+        (boundingRect.bound.maxX - boundingRect.bound.minX) * 0.5f,
+        (boundingRect.bound.maxY - boundingRect.bound.minY) * 0.5f
+        }));
+}
+
+
+template<typename T>
+static inline void SwapRemove(std::vector<T> &v, uint32_t index) {
+    v[index] = v.back();
+    v.pop_back();
+}
+
+
+void CorePhysics::DestroyCollider(ColliderHandle handle) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) {
+        Debug::Logger("DestroyCollider: invalid handle ", handle.index);
+        return;
+    }
+    uint32_t slot = handle.index;
+    uint32_t last = ColliderCount(world) - 1;
+    // whatever rested on it has to fall again
+    RequestWake(world, index);
+    world->flags[index] = 0;
+    UpdateAwake(world, index);
+    if(world->owners[index]) world->owners[index]->collider = INVALID_COLLIDER;
+
+    // pairs hold dense indices, drop the removed one and rename the moved one
+    auto removed = [&](const ColliderPair &pair) { return pair.a == index || pair.b == index; };
+    world->pairs.erase(std::remove_if(world->pairs.begin(), world->pairs.end(), removed), world->pairs.end());
+    for(ColliderPair &pair : world->pairs) {
+        if(pair.a == last) pair.a = index;
+        if(pair.b == last) pair.b = index;
+        if(pair.a > pair.b) std::swap(pair.a, pair.b);
+    }
+    std::sort(world->pairs.begin(), world->pairs.end(), PairLess);
+
+    // a reused slot must not pick up old impulses
+    auto involved = [&](const Contact &contact) {
+        return (contact.key >> 32) == slot || (uint32_t) contact.key == slot;
+    };
+    std::vector<Contact> &previous = world->previousContacts;
+    previous.erase(std::remove_if(previous.begin(), previous.end(), involved), previous.end());
+    world->contacts.erase(std::remove_if(world->contacts.begin(), world->contacts.end(), involved), world->contacts.end());
+    // destroyed by game code, its touches end without an event, none may
+    // be left for a collider that reuses the slot to end or carry over
+    auto touched = [&](const Touch &touch) {
+        return (touch.key >> 32) == slot || (uint32_t) touch.key == slot;
+    };
+    std::vector<Touch> &touches = world->touches;
+    touches.erase(std::remove_if(touches.begin(), touches.end(), touched), touches.end());
+    std::vector<Touch> &previousTouches = world->previousTouches;
+    previousTouches.erase(std::remove_if(previousTouches.begin(), previousTouches.end(), touched), previousTouches.end());
+
+    if(index < world->proxies.size()) {
+        CoreDSA::DestroyProxy(&world->tree, world->proxies[index]);
+        SwapRemove(world->proxies, index);
+        if(index < world->proxies.size()) world->tree.nodes[world->proxies[index]].userData = index;
+    }
+
+    SwapRemove(world->positions, index);
+    SwapRemove(world->velocities, index);
+    SwapRemove(world->inverseMasses, index);
+    SwapRemove(world->frictions, index);
+    SwapRemove(world->restitutions, index);
+    SwapRemove(world->previousPositions, index);
+    SwapRemove(world->syncPositions, index);
+    SwapRemove(world->syncLocals, index);
+    SwapRemove(world->bounds, index);
+    SwapRemove(world->shapes, index);
+    SwapRemove(world->flags, index);
+    SwapRemove(world->sleepTimers, index);
+    SwapRemove(world->sleepIslands, index);
+    SwapRemove(world->categories, index);
+    SwapRemove(world->masks, index);
+    SwapRemove(world->owners, index);
+    SwapRemove(world->handles, index);
+    if(index < world->handles.size()) world->denseIndex[world->handles[index]] = index;
+    world->denseIndex[slot] = INVALID_INDEX;
+    // older handles to the slot go stale, 0 is skipped so it never resolves
+    if(++world->generations[slot] == 0) world->generations[slot] = 1;
+    world->freeHandles.push_back(slot);
+    world->boundsDirty = true;
+    world->structureVersion++;
+}
+
+
+bool CorePhysics::IsValidCollider(ColliderHandle handle) {
+    return DenseIndex(CoreGlobals::physicsWorld, handle) != INVALID_INDEX;
+}
+
+
+Vector2 CorePhysics::GetVelocity(ColliderHandle handle) {
+    uint32_t index = DenseIndex(CoreGlobals::physicsWorld, handle);
+    if(index == INVALID_INDEX) return Vector2{0.0f, 0.0f};
+    return CoreGlobals::physicsWorld->velocities[index];
+}
+
+
+void CorePhysics::SetVelocity(ColliderHandle handle, const Vector2 &velocity) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return;
+    world->velocities[index] = velocity;
+    RequestWake(world, index);
+}
+
+
+Vector2 CorePhysics::GetPosition(ColliderHandle handle) {
+    uint32_t index = DenseIndex(CoreGlobals::physicsWorld, handle);
+    if(index == INVALID_INDEX) return Vector2{0.0f, 0.0f};
+    return CoreGlobals::physicsWorld->positions[index];
 }
 
 
-void CorePhysics::RegisterCollider(Collider *collider) {
-    CoreGlobals::physicsWorld->colliders.push_back(collider);
+void CorePhysics::SetCollisionFilter(ColliderHandle handle, const CollisionFilter &filter) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return;
+    world->categories[index] = filter.categories;
+    world->masks[index] = filter.mask;
+    // kept tree pairs were filtered with the old bits, look this proxy up again
+    if(index < world->proxies.size()) CoreDSA::TouchProxy(&world->tree, world->proxies[index]);
+    RequestWake(world, index);
 }
 
 
-static bool CheckColliderIntersection(Collider *source, Collider *target) {
-    bool intersect = false;
-    if(source->type == BOX_COLLIDER && target->type == BOX_COLLIDER) {
-        BoxCollider *boxA = reinterpret_cast<BoxCollider*>(source);
-        BoxCollider *boxB = reinterpret_cast<BoxCollider*>(target);
-        return CoreGeometry::Intersect(&boxA->AABB, &boxB->AABB);
+CollisionFilter CorePhysics::GetCollisionFilter(ColliderHandle handle) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return CollisionFilter{};
+    return CollisionFilter{world->categories[index], world->masks[index]};
+}
+
+
+void CorePhysics::SetColliderFlags(ColliderHandle handle, uint32_t flags) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return;
+    world->flags[index] = (world->flags[index] & COLLIDER_DIRTY) | (flags & ~COLLIDER_DIRTY);
+    MarkDirty(world, index);
+    UpdateAwake(world, index);
+}
+
+
+void CorePhysics::SetStatic(ColliderHandle handle, bool isStatic) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return;
+    RequestWake(world, index);
+    if(isStatic) {
+        world->flags[index] |= COLLIDER_STATIC;
+        world->velocities[index] = Vector2{0.0f, 0.0f};
+    }else{
+        world->flags[index] &= ~COLLIDER_STATIC;
     }
-    //else if...
-    return intersect;
+    MarkDirty(world, index);
+    UpdateAwake(world, index);
+}
+
+
+void CorePhysics::SetMass(ColliderHandle handle, float mass) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return;
+    world->inverseMasses[index] = mass > 0.0f ? 1.0f / mass : 0.0f;
+    RequestWake(world, index);
+}
+
+
+void CorePhysics::SetBullet(ColliderHandle handle, bool isBullet) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return;
+    if(isBullet) world->flags[index] |= COLLIDER_BULLET;
+    else world->flags[index] &= ~COLLIDER_BULLET;
+    MarkDirty(world, index);
+}
+
+
+void CorePhysics::SetSensor(ColliderHandle handle, bool isSensor) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return;
+    if(isSensor) world->flags[index] |= COLLIDER_SENSOR;
+    else world->flags[index] &= ~COLLIDER_SENSOR;
+    RequestWake(world, index);
+}
+
+
+void CorePhysics::SetMaterial(ColliderHandle handle, float friction, float restitution) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return;
+    world->frictions[index] = friction;
+    world->restitutions[index] = restitution;
+}
+
+
+bool CorePhysics::IsSleeping(ColliderHandle handle) {
+    uint32_t index = DenseIndex(CoreGlobals::physicsWorld, handle);
+    if(index == INVALID_INDEX) return false;
+    return (CoreGlobals::physicsWorld->flags[index] & COLLIDER_SLEEPING) != 0;
+}
+
+
+void CorePhysics::WakeCollider(ColliderHandle handle) {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t index = DenseIndex(world, handle);
+    if(index == INVALID_INDEX) return;
+    RequestWake(world, index);
 }
 
 
-static void CollisionResolve(Collider *source, Collider *target) {
-    if(source->type == BOX_COLLIDER && target->type == BOX_COLLIDER) {
-        BoxCollider *boxA = reinterpret_cast<BoxCollider*>(source);
-        BoxCollider *boxB = reinterpret_cast<BoxCollider*>(target);
-        boxA->velocity = CoreMath::VectorMul(boxA->velocity, -1.0f);
+void CorePhysics::SetSleepThresholds(float sleepVelocity, float timeToSleep, bool allowSleep) {
+    World *world = CoreGlobals::physicsWorld;
+    world->sleepVelocity = sleepVelocity;
+    world->timeToSleep = timeToSleep;
+    world->allowSleep = allowSleep;
+    if(!allowSleep) {
+        for(uint32_t i = 0; i < ColliderCount(world); i++) RequestWake(world, i);
     }
 }
 
 
-static void Integrate(Collider *collider, float deltaTime) {
-    if(collider->type == BOX_COLLIDER) {
-        BoxCollider *box = reinterpret_cast<BoxCollider*>(collider);
-        box->transform.pos.x += box->velocity.x;
-        box->transform.pos.y += box->velocity.y;
-        collider->owner->transform.pos.x += box->velocity.x;
-        collider->owner->transform.pos.y += box->velocity.y;
+static inline Affine2D PositionTransform(const Vector2 &position) {
+    Affine2D transform = CoreMath::IdentityAffine2D();
+    transform.m13 = position.x;
+    transform.m23 = position.y;
+    return transform;
+}
+
+
+static inline Affine2D ColliderTransform(const World *world, uint32_t index) {
+    return PositionTransform(world->positions[index]);
+}
+
+
+static bool CheckColliderIntersection(World *world, uint32_t a, uint32_t b, CoreGeometry::Manifold *manifold) {
+    // cheap reject before the narrowphase
+    if(!CoreGeometry::Intersect(&world->bounds[a], &world->bounds[b])) return false;
+    return CoreGeometry::Collide(
+        world->shapes[a], ColliderTransform(world, a),
+        world->shapes[b], ColliderTransform(world, b),
+        manifold
+        );
+}
+
+
+/*
+ * Narrowphase
+ * Every pair writes only its own slot, batches of pairs run in parallel.
+ * */
+
+
+static void NarrowphaseBatch(uint32_t batch, uint32_t begin, uint32_t end, void *context) {
+    World *world = (World*) context;
+    for(uint32_t i = begin; i < end; i++) {
+        const ColliderPair &pair = world->pairs[i];
+        bool test = CanTouch(world->flags[pair.a], world->flags[pair.b]);
+        world->touching[i] = test && CheckColliderIntersection(world, pair.a, pair.b, &world->manifolds[i]);
     }
 }
 
 
+static void NarrowphasePass(World *world) {
+    uint32_t count = world->pairs.size();
+    world->manifolds.resize(count);
+    world->touching.resize(count);
+    CoreJobs::ParallelFor(count, CONTACT_BATCH_SIZE, NarrowphaseBatch, world);
+}
+
+
 /*
- * Case When it's too fast
- * |----|------|-----| Actual  (1.6ms)
- * |----*---|--------| Physics (3.3ms) -> Catchup=0, Skip=2
- * Case When it's too slow
- * |-----------------| Actual  (3.3ms)
- * |--------|--------| Physics (1.6ms) -> Catchup=2, Skip=0
- * Case When it's on time
- * |--------|--------| Actual  (3.3ms)
- * |--------|--------| Physics (3.3ms) -> Catchup=0, Skip=0
- * Approach:
- *  - accumulate deltaTime each physics step
- *  - decrement accumulate -= fixedStepPeriod;
- *  - perform step until accumulate <= 0
- *  - too fast case won't need any treatment as it's handled by the win32 sleep()
- *
+ * Contacts
+ * Touching pairs become contacts, a contact that existed last step keeps
+ * the accumulated impulses of every point that stayed close to an old one.
  * */
-void CorePhysics::Step(double deltaTime) {
-    stepAccumulateTime += deltaTime;
-
-    // catchup
-    int count=0;
-    while(stepAccumulateTime >= targetStepTime ) {
-        // Debug::Logger("physics catching up ", count++, stepAccumulateTime);
-        uint32_t n = CoreGlobals::physicsWorld->colliders.size();
-        for(uint32_t i = 0; i < n ; i++) {
-            Collider *source = CoreGlobals::physicsWorld->colliders[i];
-            for(uint32_t j = i + 1; j < n; j++) {
-                Collider *target = CoreGlobals::physicsWorld->colliders[j];
-                if(CheckColliderIntersection(source, target)) {
-                    Debug::Logger("Collision Detected");
-                    CollisionResolve(source, target);
-                }
+
+
+static inline uint64_t ContactKey(const World *world, uint32_t a, uint32_t b) {
+    uint64_t handleA = world->handles[a];
+    uint64_t handleB = world->handles[b];
+    return handleA < handleB ? (handleA << 32) | handleB : (handleB << 32) | handleA;
+}
+
+
+static bool ContactLess(const Contact &a, const Contact &b) {
+    return a.key < b.key;
+}
+
+
+static void WarmStartFrom(Contact *contact, const Contact &previous) {
+    const CoreGeometry::Manifold &manifold = contact->manifold;
+    for(uint32_t i = 0; i < manifold.pointCount; i++) {
+        for(uint32_t j = 0; j < previous.manifold.pointCount; j++) {
+            Vector2 d = CoreMath::VectorSubtract(manifold.points[i], previous.manifold.points[j]);
+            if(CoreMath::Dot(d, d) > CONTACT_MATCH_DISTANCE * CONTACT_MATCH_DISTANCE) continue;
+            // impulses are scalars along normal and tangent, both flip together
+            // when the dense order of the pair swaps, so they carry over as is
+            contact->normalImpulses[i] = previous.normalImpulses[j];
+            contact->tangentImpulses[i] = previous.tangentImpulses[j];
+            break;
+        }
+    }
+}
+
+
+static void UpdateContacts(World *world) {
+    std::swap(world->contacts, world->previousContacts);
+    std::vector<Contact> &previous = world->previousContacts;
+    std::sort(previous.begin(), previous.end(), ContactLess);
+
+    world->contacts.clear();
+    uint32_t count = world->pairs.size();
+    for(uint32_t i = 0; i < count; i++) {
+        if(!world->touching[i]) continue;
+        uint32_t a = world->pairs[i].a;
+        uint32_t b = world->pairs[i].b;
+        if((world->flags[a] | world->flags[b]) & COLLIDER_SENSOR) continue;
+        Contact contact = {};
+        contact.key = ContactKey(world, a, b);
+        contact.a = a;
+        contact.b = b;
+        contact.manifold = world->manifolds[i];
+        contact.friction = std::sqrt(world->frictions[a] * world->frictions[b]);
+        contact.restitution = std::max(world->restitutions[a], world->restitutions[b]);
+        if(world->warmStarting) {
+            auto it = std::lower_bound(previous.begin(), previous.end(), contact, ContactLess);
+            if(it != previous.end() && it->key == contact.key) WarmStartFrom(&contact, *it);
+        }
+        world->contacts.push_back(contact);
+    }
+}
+
+
+/*
+ * Islands
+ * Colliders linked by contacts form an island, islands share no moving
+ * collider so they are solved in parallel. Inside an island contacts
+ * keep the sorted pair order, the same order a serial step would use.
+ * */
+
+
+static uint32_t FindRoot(std::vector<uint32_t> &parent, uint32_t i) {
+    while(parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+
+// Only awake colliders and the colliders of a contact get a union find entry,
+// static and sleeping colliders away from any contact are never visited
+static void BuildIslands(World *world) {
+    std::vector<uint32_t> &parent = world->islandParent;
+    parent.resize(ColliderCount(world));
+    for(uint32_t handle : world->awakeHandles) {
+        uint32_t i = world->denseIndex[handle];
+        parent[i] = i;
+    }
+    uint32_t count = world->contacts.size();
+    for(uint32_t i = 0; i < count; i++) {
+        parent[world->contacts[i].a] = world->contacts[i].a;
+        parent[world->contacts[i].b] = world->contacts[i].b;
+    }
+
+    for(uint32_t i = 0; i < count; i++) {
+        const Contact &contact = world->contacts[i];
+        // static colliders do not link islands
+        if((world->flags[contact.a] | world->flags[contact.b]) & COLLIDER_STATIC) continue;
+        uint32_t rootA = FindRoot(parent, contact.a);
+        uint32_t rootB = FindRoot(parent, contact.b);
+        // smaller index wins so the roots only depend on the pair list
+        if(rootA < rootB) parent[rootB] = rootA;
+        else if(rootB < rootA) parent[rootA] = rootB;
+    }
+
+    // key = island root << 32 | contact index, sorting groups islands and keeps pair order
+    world->islandContacts.clear();
+    for(uint32_t i = 0; i < count; i++) {
+        const Contact &contact = world->contacts[i];
+        uint64_t root = FindRoot(parent, IsAwakeDynamic(world->flags[contact.a]) ? contact.a : contact.b);
+        world->islandContacts.push_back((root << 32) | i);
+    }
+    std::sort(world->islandContacts.begin(), world->islandContacts.end());
+
+    world->islandStarts.clear();
+    uint32_t contacts = world->islandContacts.size();
+    for(uint32_t i = 0; i < contacts; i++) {
+        if(i == 0 || (world->islandContacts[i] >> 32) != (world->islandContacts[i - 1] >> 32)) {
+            world->islandStarts.push_back(i);
+        }
+    }
+    world->islandStarts.push_back(contacts);
+}
+
+
+/*
+ * Solver
+ * Sequential impulses on linear bodies. Static and sleeping colliders have
+ * no inverse mass here and their velocities are never written, so islands
+ * touching the same static collider still solve in parallel.
+ * */
+
+
+static inline float SolverInverseMass(const World *world, uint32_t i) {
+    return IsAwakeDynamic(world->flags[i]) ? world->inverseMasses[i] : 0.0f;
+}
+
+
+static inline Vector2 Tangent(const Vector2 &normal) {
+    return Vector2{normal.y, -normal.x};
+}
+
+
+static inline void ApplyImpulse(World *world, const Contact &contact, const Vector2 &impulse, float inverseMassA, float inverseMassB) {
+    if(inverseMassA > 0.0f) {
+        world->velocities[contact.a] = CoreMath::VectorSubtract(world->velocities[contact.a], CoreMath::VectorMul(impulse, inverseMassA));
+    }
+    if(inverseMassB > 0.0f) {
+        world->velocities[contact.b] = CoreMath::VectorAdd(world->velocities[contact.b], CoreMath::VectorMul(impulse, inverseMassB));
+    }
+}
+
+
+// Computes the effective mass and the target velocities, then applies the warm start impulses
+static void PrepareContact(World *world, Contact *contact, float inverseDeltaTime) {
+    float inverseMassA = SolverInverseMass(world, contact->a);
+    float inverseMassB = SolverInverseMass(world, contact->b);
+    float k = inverseMassA + inverseMassB;
+    contact->mass = k > 0.0f ? 1.0f / k : 0.0f;
+
+    const Vector2 &normal = contact->manifold.normal;
+    Vector2 tangent = Tangent(normal);
+    Vector2 dv = CoreMath::VectorSubtract(world->velocities[contact->b], world->velocities[contact->a]);
+    float normalVelocity = CoreMath::Dot(dv, normal);
+    float bounce = normalVelocity < -RESTITUTION_THRESHOLD ? -contact->restitution * normalVelocity : 0.0f;
+
+    for(uint32_t i = 0; i < contact->manifold.pointCount; i++) {
+        float recovery = BAUMGARTE * inverseDeltaTime * std::max(contact->manifold.depths[i] - LINEAR_SLOP, 0.0f);
+        contact->velocityBiases[i] = std::max(bounce, recovery);
+        Vector2 impulse = CoreMath::VectorAdd(
+            CoreMath::VectorMul(normal, contact->normalImpulses[i]),
+            CoreMath::VectorMul(tangent, contact->tangentImpulses[i])
+            );
+        ApplyImpulse(world, *contact, impulse, inverseMassA, inverseMassB);
+    }
+}
+
+
+static void SolveContact(World *world, Contact *contact) {
+    if(contact->mass == 0.0f) return;
+    float inverseMassA = SolverInverseMass(world, contact->a);
+    float inverseMassB = SolverInverseMass(world, contact->b);
+    const Vector2 &normal = contact->manifold.normal;
+    Vector2 tangent = Tangent(normal);
+
+    for(uint32_t i = 0; i < contact->manifold.pointCount; i++) {
+        // friction, bounded by the normal impulse of the point
+        Vector2 dv = CoreMath::VectorSubtract(world->velocities[contact->b], world->velocities[contact->a]);
+        float lambda = -contact->mass * CoreMath::Dot(dv, tangent);
+        float maxFriction = contact->friction * contact->normalImpulses[i];
+        float accumulated = std::max(-maxFriction, std::min(contact->tangentImpulses[i] + lambda, maxFriction));
+        lambda = accumulated - contact->tangentImpulses[i];
+        contact->tangentImpulses[i] = accumulated;
+        ApplyImpulse(world, *contact, CoreMath::VectorMul(tangent, lambda), inverseMassA, inverseMassB);
+
+        // non penetration, the accumulated impulse may only push
+        dv = CoreMath::VectorSubtract(world->velocities[contact->b], world->velocities[contact->a]);
+        lambda = contact->mass * (contact->velocityBiases[i] - CoreMath::Dot(dv, normal));
+        accumulated = std::max(contact->normalImpulses[i] + lambda, 0.0f);
+        lambda = accumulated - contact->normalImpulses[i];
+        contact->normalImpulses[i] = accumulated;
+        ApplyImpulse(world, *contact, CoreMath::VectorMul(normal, lambda), inverseMassA, inverseMassB);
+    }
+}
+
+
+struct SolveContext {
+    World *world;
+    float deltaTime;
+    float inverseDeltaTime;
+};
+
+
+static void SolveIslandBatch(uint32_t batch, uint32_t begin, uint32_t end, void *context) {
+    SolveContext *ctx = (SolveContext*) context;
+    World *world = ctx->world;
+    for(uint32_t island = begin; island < end; island++) {
+        uint32_t first = world->islandStarts[island];
+        uint32_t last = world->islandStarts[island + 1];
+        for(uint32_t c = first; c < last; c++) {
+            PrepareContact(world, &world->contacts[(uint32_t) world->islandContacts[c]], ctx->inverseDeltaTime);
+        }
+        for(uint32_t iteration = 0; iteration < world->velocityIterations; iteration++) {
+            for(uint32_t c = first; c < last; c++) {
+                SolveContact(world, &world->contacts[(uint32_t) world->islandContacts[c]]);
             }
         }
-        for(uint32_t i = 0; i < n ; i++) {
-            Collider *collider = CoreGlobals::physicsWorld->colliders[i];
-            Integrate(collider, deltaTime);
+    }
+}
+
+
+// Work items are the awake colliders
+static void GravityBatch(uint32_t batch, uint32_t begin, uint32_t end, void *context) {
+    SolveContext *ctx = (SolveContext*) context;
+    World *world = ctx->world;
+    Vector2 dv = CoreMath::VectorMul(world->gravity, ctx->deltaTime);
+    for(uint32_t k = begin; k < end; k++) {
+        uint32_t i = world->denseIndex[world->awakeHandles[k]];
+        if(world->inverseMasses[i] == 0.0f) continue;
+        world->velocities[i] = CoreMath::VectorAdd(world->velocities[i], dv);
+    }
+}
+
+
+static void SolvePass(World *world, float deltaTime) {
+    SolveContext ctx = {world, deltaTime, 1.0f / deltaTime};
+    if(world->gravity.x != 0.0f || world->gravity.y != 0.0f) {
+        CoreJobs::ParallelFor(world->awakeHandles.size(), INTEGRATE_BATCH_SIZE, GravityBatch, &ctx);
+    }
+    UpdateContacts(world);
+    BuildIslands(world);
+    uint32_t islandCount = world->islandStarts.size() - 1;
+    CoreJobs::ParallelFor(islandCount, ISLAND_BATCH_SIZE, SolveIslandBatch, &ctx);
+}
+
+
+/*
+ * Events
+ * The touching pairs of a step are compared by key with the ones of the
+ * step before, the differences become begin and end events. A pair whose
+ * colliders are both resting is not tested by the narrowphase, it is
+ * carried over so falling asleep does not end a contact.
+ * */
+
+
+static bool TouchLess(const Touch &a, const Touch &b) {
+    return a.key < b.key;
+}
+
+
+static void PushEvent(World *world, ContactEventType type, uint32_t a, uint32_t b, const CoreGeometry::Manifold *manifold) {
+    ContactEvent event;
+    event.type = type;
+    event.collider = HandleAt(world, a);
+    event.other = HandleAt(world, b);
+    event.owner = world->owners[a];
+    event.otherOwner = world->owners[b];
+    event.normal = manifold ? manifold->normal : Vector2{0.0f, 0.0f};
+    event.point = manifold ? manifold->points[0] : Vector2{0.0f, 0.0f};
+    world->events.push_back(event);
+}
+
+
+static inline bool IsResting(uint32_t flags) {
+    return (flags & COLLIDER_ACTIVE) && !IsAwakeDynamic(flags);
+}
+
+
+// A touch of the last step that is gone now, ended unless both sides rest
+static void EndTouch(World *world, const Touch &touch) {
+    uint32_t a = DenseIndex(world, (uint32_t) (touch.key >> 32));
+    uint32_t b = DenseIndex(world, (uint32_t) touch.key);
+    if(a == INVALID_INDEX || b == INVALID_INDEX) return;
+    if(IsResting(world->flags[a]) && IsResting(world->flags[b]) && ShouldCollide(world, a, b)) {
+        world->carriedTouches.push_back(Touch{touch.key, INVALID_INDEX, touch.sensor});
+        return;
+    }
+    PushEvent(world, touch.sensor ? TRIGGER_END : CONTACT_END, a, b, nullptr);
+}
+
+
+static void EventPass(World *world) {
+    std::swap(world->touches, world->previousTouches);
+    std::vector<Touch> &touches = world->touches;
+    const std::vector<Touch> &previous = world->previousTouches;
+    touches.clear();
+    uint32_t count = world->pairs.size();
+    for(uint32_t i = 0; i < count; i++) {
+        if(!world->touching[i]) continue;
+        const ColliderPair &pair = world->pairs[i];
+        uint32_t sensor = (world->flags[pair.a] | world->flags[pair.b]) & COLLIDER_SENSOR;
+        touches.push_back(Touch{ContactKey(world, pair.a, pair.b), i, sensor});
+    }
+    std::sort(touches.begin(), touches.end(), TouchLess);
+
+    // touches only grows through carried, which is merged in after the walk
+    std::vector<Touch> &carried = world->carriedTouches;
+    carried.clear();
+    uint32_t j = 0;
+    for(const Touch &touch : touches) {
+        while(j < previous.size() && previous[j].key < touch.key) EndTouch(world, previous[j++]);
+        const ColliderPair &pair = world->pairs[touch.pair];
+        const CoreGeometry::Manifold &manifold = world->manifolds[touch.pair];
+        if(j < previous.size() && previous[j].key == touch.key) {
+            j++;
+            if(!touch.sensor) PushEvent(world, CONTACT_STAY, pair.a, pair.b, &manifold);
+        }else{
+            PushEvent(world, touch.sensor ? TRIGGER_BEGIN : CONTACT_BEGIN, pair.a, pair.b, &manifold);
+        }
+    }
+    while(j < previous.size()) EndTouch(world, previous[j++]);
+
+    if(!carried.empty()) {
+        touches.insert(touches.end(), carried.begin(), carried.end());
+        std::sort(touches.begin(), touches.end(), TouchLess);
+    }
+}
+
+
+void CorePhysics::DispatchContactEvents() {
+    World *world = CoreGlobals::physicsWorld;
+    uint32_t count = world->events.size();
+    for(uint32_t i = 0; i < count; i++) {
+        const ContactEvent &event = world->events[i];
+        if(event.owner && event.owner->attribute.behavior.OnContact) {
+            event.owner->attribute.behavior.OnContact(&event.owner->attribute, event);
+        }
+        if(event.otherOwner && event.otherOwner->attribute.behavior.OnContact) {
+            // the same event seen from the other side
+            ContactEvent flipped = event;
+            std::swap(flipped.collider, flipped.other);
+            std::swap(flipped.owner, flipped.otherOwner);
+            flipped.normal = CoreMath::VectorMul(event.normal, -1.0f);
+            event.otherOwner->attribute.behavior.OnContact(&event.otherOwner->attribute, flipped);
         }
-        stepAccumulateTime = std::min<double>(stepAccumulateTime - targetStepTime, 0.0f);
     }
+}
+
+
+const std::vector<ContactEvent>& CorePhysics::GetContactEvents() {
+    return CoreGlobals::physicsWorld->events;
+}
+
+
+/*
+ * Sleeping
+ * An island sleeps once all of its colliders stayed below sleepVelocity for
+ * timeToSleep. Sleeping colliders keep the handle of their island root, so a
+ * wake request for one of them wakes everything it went to sleep with.
+ * */
+
+
+// Queues sleeping colliders touched by an awake one, then wakes every queued island
+static void WakePass(World *world) {
+    uint32_t count = world->pairs.size();
+    for(uint32_t i = 0; i < count; i++) {
+        if(!world->touching[i]) continue;
+        const ColliderPair &pair = world->pairs[i];
+        // overlapping a trigger does not disturb a sleeping collider
+        if((world->flags[pair.a] | world->flags[pair.b]) & COLLIDER_SENSOR) continue;
+        if(world->flags[pair.a] & COLLIDER_SLEEPING) RequestWake(world, pair.a);
+        if(world->flags[pair.b] & COLLIDER_SLEEPING) RequestWake(world, pair.b);
+    }
+    if(world->wakeIslands.empty()) return;
+
+    std::vector<uint32_t> &islands = world->wakeIslands;
+    std::sort(islands.begin(), islands.end());
+    islands.erase(std::unique(islands.begin(), islands.end()), islands.end());
+    uint32_t n = ColliderCount(world);
+    for(uint32_t i = 0; i < n; i++) {
+        if(!(world->flags[i] & COLLIDER_SLEEPING)) continue;
+        if(!std::binary_search(islands.begin(), islands.end(), world->sleepIslands[i])) continue;
+        world->flags[i] &= ~COLLIDER_SLEEPING;
+        MarkDirty(world, i);
+        UpdateAwake(world, i);
+        world->sleepTimers[i] = 0.0f;
+        world->sleepIslands[i] = world->handles[i];
+    }
+    islands.clear();
+}
+
+
+// Runs after integrate, islands come from the solve of the same step.
+// Walks the awake list only, static and sleeping colliders cost nothing.
+static void SleepPass(World *world, float deltaTime) {
+    if(!world->allowSleep) return;
+    float threshold = world->sleepVelocity * world->sleepVelocity;
+    std::vector<float> &islandTimes = world->islandSleepTimes;
+    std::vector<uint32_t> &awake = world->awakeHandles;
+    islandTimes.resize(ColliderCount(world));
+    for(uint32_t handle : awake) {
+        islandTimes[FindRoot(world->islandParent, world->denseIndex[handle])] = FLT_MAX;
+    }
+    for(uint32_t handle : awake) {
+        uint32_t i = world->denseIndex[handle];
+        const Vector2 &v = world->velocities[i];
+        if(v.x * v.x + v.y * v.y < threshold) world->sleepTimers[i] += deltaTime;
+        else world->sleepTimers[i] = 0.0f;
+        uint32_t root = FindRoot(world->islandParent, i);
+        islandTimes[root] = std::min(islandTimes[root], world->sleepTimers[i]);
+    }
+    // backwards, falling asleep swaps the last awake collider into the freed slot
+    for(uint32_t k = awake.size(); k-- > 0;) {
+        uint32_t i = world->denseIndex[awake[k]];
+        uint32_t root = FindRoot(world->islandParent, i);
+        if(islandTimes[root] < world->timeToSleep) continue;
+        world->flags[i] |= COLLIDER_SLEEPING;
+        world->velocities[i] = Vector2{0.0f, 0.0f};
+        world->sleepIslands[i] = world->handles[root];
+        UpdateAwake(world, i);
+        world->sleptHandles.push_back(world->handles[i]);
+    }
+}
+
+
+/*
+ * Continuous collision
+ * Bullets carry bounds swept over their next step, so the broadphase pairs
+ * them with everything along the path. After integration each bullet is
+ * swept again from its previous position against those candidates, which
+ * are held at their new positions. On impact the bullet stops at the time
+ * of impact, its velocity is resolved against the hit collider and the rest
+ * of the step continues from there. Only bullets are written, batches of
+ * bullets run in parallel.
+ * */
 
+
+static inline bool IsBullet(uint32_t flags) {
+    return IsAwakeDynamic(flags) && (flags & COLLIDER_BULLET);
 }
 
+
+// Fraction range of motion in which the moving bounds overlap the fixed ones,
+// a slab test of the motion against the fixed bounds grown by the moving ones
+static bool SweepRange(
+    const CoreGeometry::BoundingRect &moving,
+    const CoreGeometry::BoundingRect &fixed,
+    const Vector2 &motion,
+    float *enter,
+    float *exit
+) {
+    const float lo[2] = {fixed.bound.minX - moving.bound.maxX, fixed.bound.minY - moving.bound.maxY};
+    const float hi[2] = {fixed.bound.maxX - moving.bound.minX, fixed.bound.maxY - moving.bound.minY};
+    const float d[2] = {motion.x, motion.y};
+    float tEnter = 0.0f;
+    float tExit = 1.0f;
+    for(int axis = 0; axis < 2; axis++) {
+        if(d[axis] == 0.0f) {
+            if(lo[axis] > 0.0f || hi[axis] < 0.0f) return false;
+            continue;
+        }
+        float t1 = lo[axis] / d[axis];
+        float t2 = hi[axis] / d[axis];
+        tEnter = std::max(tEnter, std::min(t1, t2));
+        tExit = std::min(tExit, std::max(t1, t2));
+    }
+    *enter = tEnter;
+    *exit = tExit;
+    return tEnter <= tExit;
+}
+
+
+// Earliest fraction of motion at which the bullet touches the other collider,
+// by conservative advancement. Returns false when there is no impact or both
+// already overlap at the start, the contact solver owns that case. safe is the
+// fraction at which the gap fell under TOI_TARGET. The bullet only translates,
+// so the gap between both convex shapes is a convex function of the fraction
+// and never falls under its tangent: advancing by gap / closing speed along
+// the normal cannot step past the first touch, however fast the bullet moves.
+// Running out of iterations keeps the last safe fraction.
+static bool TimeOfImpact(
+    const World *world,
+    uint32_t bullet,
+    uint32_t other,
+    const Vector2 &start,
+    const Vector2 &motion,
+    float *safe,
+    CoreGeometry::Manifold *manifold
+) {
+    const CoreGeometry::Shape &shape = world->shapes[bullet];
+    const CoreGeometry::Shape &otherShape = world->shapes[other];
+    Affine2D otherTransform = ColliderTransform(world, other);
+
+    CoreGeometry::Manifold m;
+    if(CoreGeometry::Collide(shape, PositionTransform(start), otherShape, otherTransform, &m)) return false;
+    float enter, exit;
+    CoreGeometry::BoundingRect moving = CoreGeometry::ComputeAABB(shape, PositionTransform(start));
+    if(!SweepRange(moving, world->bounds[other], motion, &enter, &exit)) return false;
+
+    float t = enter;
+    for(uint32_t i = 0; i < TOI_ITERATIONS; i++) {
+        Vector2 p = CoreMath::VectorAdd(start, CoreMath::VectorMul(motion, t));
+        float gap = CoreGeometry::Distance(shape, PositionTransform(p), otherShape, otherTransform, &m);
+        // normal points from the bullet to the other collider, a gap that does not close only grows
+        float closing = CoreMath::Dot(motion, m.normal);
+        if(closing <= 0.0f) return false;
+        *safe = t;
+        *manifold = m;
+        if(gap <= TOI_TARGET) return true;
+        // aims inside the target band so rounding never lands in the other collider
+        t += (gap - TOI_TARGET * 0.5f) / closing;
+        if(t > exit) return false;
+    }
+    return true;
+}
+
+
+// Impulse on the bullet alone, the other collider acts as if infinitely heavy
+static void ResolveImpact(World *world, uint32_t bullet, uint32_t other, const CoreGeometry::Manifold &manifold) {
+    const Vector2 &normal = manifold.normal;
+    Vector2 tangent = Tangent(normal);
+    Vector2 otherVelocity = IsAwakeDynamic(world->flags[other]) ? world->velocities[other] : Vector2{0.0f, 0.0f};
+    Vector2 dv = CoreMath::VectorSubtract(world->velocities[bullet], otherVelocity);
+    float normalVelocity = CoreMath::Dot(dv, normal);
+    if(normalVelocity <= 0.0f) return;
+    float restitution = std::max(world->restitutions[bullet], world->restitutions[other]);
+    float friction = std::sqrt(world->frictions[bullet] * world->frictions[other]);
+    float normalImpulse = (1.0f + restitution) * normalVelocity;
+    float tangentVelocity = CoreMath::Dot(dv, tangent);
+    float tangentImpulse = std::max(-friction * normalImpulse, std::min(tangentVelocity, friction * normalImpulse));
+    world->velocities[bullet] = CoreMath::VectorSubtract(world->velocities[bullet], CoreMath::VectorAdd(
+        CoreMath::VectorMul(normal, normalImpulse),
+        CoreMath::VectorMul(tangent, tangentImpulse)
+        ));
+}
+
+
+struct ContinuousContext {
+    World *world;
+    float deltaTime;
+};
+
+
+static void ContinuousBatch(uint32_t batch, uint32_t begin, uint32_t end, void *context) {
+    ContinuousContext *ctx = (ContinuousContext*) context;
+    World *world = ctx->world;
+    for(uint32_t group = begin; group < end; group++) {
+        uint32_t first = world->bulletStarts[group];
+        uint32_t last = world->bulletStarts[group + 1];
+        uint32_t bullet = (uint32_t) (world->bulletPairs[first] >> 32);
+        Vector2 start = world->previousPositions[bullet];
+        float remaining = 1.0f;
+        for(uint32_t substep = 0; substep < MAX_TOI_SUBSTEPS && remaining > 0.0f; substep++) {
+            Vector2 motion = CoreMath::VectorMul(world->velocities[bullet], ctx->deltaTime * remaining);
+            float earliest = 1.0f;
+            uint32_t hit = INVALID_INDEX;
+            CoreGeometry::Manifold hitManifold = {};
+            for(uint32_t c = first; c < last; c++) {
+                uint32_t other = (uint32_t) world->bulletPairs[c];
+                float safe;
+                CoreGeometry::Manifold manifold;
+                if(!TimeOfImpact(world, bullet, other, start, motion, &safe, &manifold)) continue;
+                if(safe >= earliest) continue;
+                earliest = safe;
+                hit = other;
+                hitManifold = manifold;
+            }
+            start = CoreMath::VectorAdd(start, CoreMath::VectorMul(motion, earliest));
+            if(hit == INVALID_INDEX) break;
+            ResolveImpact(world, bullet, hit, hitManifold);
+            remaining *= 1.0f - earliest;
+        }
+        world->positions[bullet] = start;
+    }
+}
+
+
+static void ContinuousPass(World *world, float deltaTime) {
+    world->bulletPairs.clear();
+    for(const ColliderPair &pair : world->pairs) {
+        uint32_t flagsA = world->flags[pair.a];
+        uint32_t flagsB = world->flags[pair.b];
+        // bullets do not sweep against each other or through triggers
+        if(IsBullet(flagsA) == IsBullet(flagsB)) continue;
+        if((flagsA | flagsB) & COLLIDER_SENSOR) continue;
+        if(!(flagsA & flagsB & COLLIDER_ACTIVE)) continue;
+        uint64_t bullet = IsBullet(flagsA) ? pair.a : pair.b;
+        uint64_t other = IsBullet(flagsA) ? pair.b : pair.a;
+        world->bulletPairs.push_back((bullet << 32) | other);
+    }
+    if(world->bulletPairs.empty()) return;
+    std::sort(world->bulletPairs.begin(), world->bulletPairs.end());
+
+    world->bulletStarts.clear();
+    uint32_t count = world->bulletPairs.size();
+    for(uint32_t i = 0; i < count; i++) {
+        if(i == 0 || (world->bulletPairs[i] >> 32) != (world->bulletPairs[i - 1] >> 32)) {
+            world->bulletStarts.push_back(i);
+        }
+    }
+    world->bulletStarts.push_back(count);
+
+    ContinuousContext ctx = {world, deltaTime};
+    CoreJobs::ParallelFor(world->bulletStarts.size() - 1, BULLET_BATCH_SIZE, ContinuousBatch, &ctx);
+}
+
+
+/*
+ * Passes
+ * */
+
+
+// Applies what game code moved since the last sync, only owners reported by
+// the transform setters are looked at. Changes are read from the owner local
+// position, the owner world matrix may hold an interpolated pose. A moved
+// owner teleports, previous state follows so nothing is interpolated, the
+// simulated displacement not yet synced is kept.
+static void PullPass(World *world) {
+    for(ColliderHandle handle : world->movedOwners) {
+        uint32_t i = DenseIndex(world, handle);
+        if(i == INVALID_INDEX) continue;
+        GameObject::Empty *owner = world->owners[i];
+        if(!owner) continue;
+        float dx = owner->transform.pos.x - world->syncLocals[i].x;
+        float dy = owner->transform.pos.y - world->syncLocals[i].y;
+        if(dx == 0.0f && dy == 0.0f) continue;
+        world->positions[i] = Vector2{world->positions[i].x + dx, world->positions[i].y + dy};
+        world->previousPositions[i] = world->positions[i];
+        world->syncPositions[i] = Vector2{world->syncPositions[i].x + dx, world->syncPositions[i].y + dy};
+        world->syncLocals[i] = Vector2{owner->transform.pos.x, owner->transform.pos.y};
+        MarkDirty(world, i);
+        RequestWake(world, i);
+    }
+    world->movedOwners.clear();
+}
+
+
+void CorePhysics::MarkOwnerMoved(ColliderHandle handle) {
+    CoreGlobals::physicsWorld->movedOwners.push_back(handle);
+}
+
+
+// position += velocity * dt for every awake dynamic collider, two colliders per lane
+static void IntegrateRange(World *world, uint32_t begin, uint32_t end, float deltaTime) {
+    float *positions = &world->positions.data()->x;
+    const float *velocities = &world->velocities.data()->x;
+    const uint32_t *flags = world->flags.data();
+    uint32_t i = begin;
+#if defined(CORE_MATH_SSE2)
+    __m128 dt = _mm_set1_ps(deltaTime);
+    for(; i + 2 <= end; i += 2) {
+        float active0 = IsAwakeDynamic(flags[i]) ? 1.0f : 0.0f;
+        float active1 = IsAwakeDynamic(flags[i + 1]) ? 1.0f : 0.0f;
+        __m128 mask = _mm_set_ps(active1, active1, active0, active0);
+        __m128 p = _mm_loadu_ps(positions + i * 2);
+        __m128 v = _mm_loadu_ps(velocities + i * 2);
+        p = _mm_add_ps(p, _mm_mul_ps(_mm_mul_ps(v, dt), mask));
+        _mm_storeu_ps(positions + i * 2, p);
+    }
+#endif
+    for(; i < end; i++) {
+        if(!IsAwakeDynamic(flags[i])) continue;
+        positions[i * 2 + 0] += velocities[i * 2 + 0] * deltaTime;
+        positions[i * 2 + 1] += velocities[i * 2 + 1] * deltaTime;
+    }
+}
+
+
+struct IntegrateContext {
+    World *world;
+    float deltaTime;
+};
+
+
+static void IntegrateBatch(uint32_t batch, uint32_t begin, uint32_t end, void *context) {
+    IntegrateContext *ctx = (IntegrateContext*) context;
+    IntegrateRange(ctx->world, begin, end, ctx->deltaTime);
+}
+
+
+static void IntegratePass(World *world, float deltaTime) {
+    IntegrateContext ctx = {world, deltaTime};
+    CoreJobs::ParallelFor(ColliderCount(world), INTEGRATE_BATCH_SIZE, IntegrateBatch, &ctx);
+}
+
+
+// Writes the displacement since the last exchange into the owner local position
+static void SyncCollider(World *world, uint32_t i) {
+    GameObject::Empty *owner = world->owners[i];
+    if(!owner) return;
+    float dx = world->positions[i].x - world->syncPositions[i].x;
+    float dy = world->positions[i].y - world->syncPositions[i].y;
+    if(dx == 0.0f && dy == 0.0f) return;
+    owner->transform.pos.x += dx;
+    owner->transform.pos.y += dy;
+    SceneGraph::QueueTransform((Node2D*) owner);
+    world->syncPositions[i] = world->positions[i];
+    world->syncLocals[i] = Vector2{owner->transform.pos.x, owner->transform.pos.y};
+}
+
+
+// Only awake colliders and the ones that fell asleep during the step moved
+static void SyncPass(World *world) {
+    for(uint32_t handle : world->awakeHandles) {
+        SyncCollider(world, world->denseIndex[handle]);
+    }
+    for(uint32_t handle : world->sleptHandles) {
+        uint32_t i = DenseIndex(world, handle);
+        if(i != INVALID_INDEX) SyncCollider(world, i);
+    }
+}
+
+
+/*
+ * Spatial grid
+ * */
+
+
+static inline int32_t CellCoord(float v, float cellSize) {
+    float c = std::floor(v / cellSize);
+    return (int32_t) std::max(-CELL_COORD_LIMIT, std::min(CELL_COORD_LIMIT, c));
+}
+
+
+static inline uint64_t CellKey(int32_t x, int32_t y) {
+    return ((uint64_t)(uint32_t) x << 32) | (uint32_t) y;
+}
+
+
+struct CellRange {
+    int32_t x0, y0, x1, y1;
+};
+
+
+static inline CellRange CellsOf(const CoreGeometry::BoundingRect &b, float cellSize) {
+    return CellRange{
+        CellCoord(b.bound.minX, cellSize), CellCoord(b.bound.minY, cellSize),
+        CellCoord(b.bound.maxX, cellSize), CellCoord(b.bound.maxY, cellSize)
+    };
+}
+
+
+static inline uint64_t CellCount(const CellRange &r) {
+    if(r.x1 < r.x0 || r.y1 < r.y0) return 0;
+    return (uint64_t) (r.x1 - r.x0 + 1) * (uint64_t) (r.y1 - r.y0 + 1);
+}
+
+
+static inline uint32_t CellSlot(uint64_t key, uint32_t slotMask) {
+    return (uint32_t) ((key * 0x9E3779B97F4A7C15ull) >> 32) & slotMask;
+}
+
+
+// First entry of the cell or INVALID_INDEX when nothing is in it
+static uint32_t FindCell(const SpatialGrid &grid, uint64_t key) {
+    if(grid.cells.empty()) return INVALID_INDEX;
+    uint32_t slotMask = grid.cells.size() - 1;
+    for(uint32_t slot = CellSlot(key, slotMask); grid.cells[slot].stamp == grid.stamp; slot = (slot + 1) & slotMask) {
+        if(grid.cells[slot].key == key) return grid.cells[slot].first;
+    }
+    return INVALID_INDEX;
+}
+
+
+// A new stamp empties the table, it only grows when the occupied cells need it
+static void BuildCellTable(SpatialGrid &grid) {
+    uint32_t runCount = grid.runs.size() - 1;
+    uint32_t slotCount = std::max<uint32_t>(grid.cells.size(), MIN_GRID_SLOTS);
+    while(slotCount < runCount * 2) slotCount *= 2;
+    if(slotCount != grid.cells.size()) {
+        grid.cells.assign(slotCount, GridCell{0, 0, 0});
+        grid.stamp = 0;
+    }
+    if(++grid.stamp == 0) {
+        for(GridCell &cell : grid.cells) cell.stamp = 0;
+        grid.stamp = 1;
+    }
+    uint32_t slotMask = slotCount - 1;
+    for(uint32_t run = 0; run < runCount; run++) {
+        uint64_t key = grid.entries[grid.runs[run]].cell;
+        uint32_t slot = CellSlot(key, slotMask);
+        while(grid.cells[slot].stamp == grid.stamp) slot = (slot + 1) & slotMask;
+        grid.cells[slot] = GridCell{key, grid.runs[run], grid.stamp};
+    }
+}
+
+
+static inline bool Overlaps(const CoreGeometry::BoundingRect &a, const CoreGeometry::BoundingRect &b) {
+    return a.bound.minX <= b.bound.maxX && a.bound.maxX >= b.bound.minX &&
+           a.bound.minY <= b.bound.maxY && a.bound.maxY >= b.bound.minY;
+}
+
+
+static void BuildGrid(World *world) {
+    SpatialGrid &grid = world->grid;
+    uint32_t n = ColliderCount(world);
+    grid.entries.clear();
+    grid.oversized.clear();
+    grid.extent.bound = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+    for(uint32_t i = 0; i < n; i++) {
+        const CoreGeometry::BoundingRect &b = world->bounds[i];
+        grid.extent.bound.minX = std::min(grid.extent.bound.minX, b.bound.minX);
+        grid.extent.bound.minY = std::min(grid.extent.bound.minY, b.bound.minY);
+        grid.extent.bound.maxX = std::max(grid.extent.bound.maxX, b.bound.maxX);
+        grid.extent.bound.maxY = std::max(grid.extent.bound.maxY, b.bound.maxY);
+
+        CellRange r = CellsOf(b, grid.cellSize);
+        if(CellCount(r) > MAX_GRID_CELLS) {
+            grid.oversized.push_back(i);
+            continue;
+        }
+        for(int32_t y = r.y0; y <= r.y1; y++) {
+            for(int32_t x = r.x0; x <= r.x1; x++) {
+                grid.entries.push_back(GridEntry{CellKey(x, y), i});
+            }
+        }
+    }
+
+    std::sort(grid.entries.begin(), grid.entries.end(), [](const GridEntry &a, const GridEntry &b) {
+        return a.cell < b.cell || (a.cell == b.cell && a.collider < b.collider);
+    });
+    grid.runs.clear();
+    uint32_t count = grid.entries.size();
+    for(uint32_t i = 0; i < count; i++) {
+        if(i == 0 || grid.entries[i].cell != grid.entries[i - 1].cell) grid.runs.push_back(i);
+    }
+    grid.runs.push_back(count);
+    BuildCellTable(grid);
+}
+
+
+// Moves the proxies of the colliders whose bounds were recomputed, only
+// proxies that left their fat bounds are reinserted and end up in the
+// tree move buffer. Colliders created since the last sync get a proxy.
+static void SyncTree(World *world) {
+    uint32_t n = ColliderCount(world);
+    uint32_t existing = world->proxies.size();
+    uint32_t count = world->boundsList.size();
+    for(uint32_t k = 0; k < count; k++) {
+        uint32_t i = world->boundsList[k];
+        if(i >= existing) continue;
+        CoreDSA::MoveProxy(&world->tree, world->proxies[i], world->bounds[i], world->boundsMotion[k]);
+    }
+    // woken or changed flags, pairs dropped while they could not touch come back
+    for(uint32_t i : world->touchList) {
+        if(i < existing) CoreDSA::TouchProxy(&world->tree, world->proxies[i]);
+    }
+    for(uint32_t i = existing; i < n; i++) {
+        world->proxies.push_back(CoreDSA::CreateProxy(&world->tree, world->bounds[i], i));
+    }
+}
+
+
+// Static and sleeping colliders keep their bounds until something marks them.
+// Sorted so the tree sees the same order however the lists were built.
+static void GatherBoundsList(World *world) {
+    std::vector<uint32_t> &list = world->boundsList;
+    list.clear();
+    world->touchList.clear();
+    for(uint32_t handle : world->awakeHandles) {
+        list.push_back(world->denseIndex[handle]);
+    }
+    for(uint32_t handle : world->dirtyHandles) {
+        uint32_t i = DenseIndex(world, handle);
+        if(i == INVALID_INDEX || !(world->flags[i] & COLLIDER_DIRTY)) continue;
+        world->touchList.push_back(i);
+        if(!IsAwakeDynamic(world->flags[i])) list.push_back(i);
+    }
+    world->dirtyHandles.clear();
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+}
+
+
+// Recomputes the bounds of the listed colliders, the motion of their center
+// is kept for the tree, which stretches moving leaves along it
+static void BoundsBatch(uint32_t batch, uint32_t begin, uint32_t end, void *context) {
+    World *world = (World*) context;
+    for(uint32_t k = begin; k < end; k++) {
+        uint32_t i = world->boundsList[k];
+        CoreGeometry::BoundingRect p = world->bounds[i];
+        world->bounds[i] = CoreGeometry::ComputeAABB(world->shapes[i], ColliderTransform(world, i));
+        if(IsBullet(world->flags[i])) {
+            // swept over the coming step so the broadphase sees the whole path
+            Vector2 motion = CoreMath::VectorMul(world->velocities[i], (float) world->fixedStep);
+            CoreGeometry::BoundingRect &b = world->bounds[i];
+            b.bound.minX += std::min(motion.x, 0.0f);
+            b.bound.maxX += std::max(motion.x, 0.0f);
+            b.bound.minY += std::min(motion.y, 0.0f);
+            b.bound.maxY += std::max(motion.y, 0.0f);
+        }
+        const CoreGeometry::BoundingRect &b = world->bounds[i];
+        world->boundsMotion[k] = Vector2{
+            (b.bound.minX + b.bound.maxX - p.bound.minX - p.bound.maxX) * 0.5f,
+            (b.bound.minY + b.bound.maxY - p.bound.minY - p.bound.maxY) * 0.5f
+        };
+        world->flags[i] &= ~COLLIDER_DIRTY;
+    }
+}
+
+
+// Recomputes the collider bounds and brings the active broadphase up to date
+static void SyncBroadphase(World *world) {
+    if(!world->boundsDirty) return;
+    uint32_t n = ColliderCount(world);
+
+    GatherBoundsList(world);
+    world->boundsMotion.resize(world->boundsList.size());
+    CoreJobs::ParallelFor(world->boundsList.size(), BOUNDS_BATCH_SIZE, BoundsBatch, world);
+
+    if(world->broadphase == BROADPHASE_TREE) {
+        SyncTree(world);
+    }else{
+        BuildGrid(world);
+    }
+
+    // stamps only ever take the current value, older ones never match again
+    world->queryStamps.resize(n, 0);
+    world->boundsDirty = false;
+}
+
+
+// Per batch outputs are concatenated in batch order then sorted,
+// so the pair list never depends on the worker count
+static void MergeBatchPairs(World *world, uint32_t batchCount) {
+    for(uint32_t batch = 0; batch < batchCount; batch++) {
+        const std::vector<ColliderPair> &pairs = world->batchPairs[batch];
+        world->pairs.insert(world->pairs.end(), pairs.begin(), pairs.end());
+    }
+    std::sort(world->pairs.begin(), world->pairs.end(), PairLess);
+}
+
+
+static void PrepareBatchPairs(World *world, uint32_t batchCount) {
+    if(world->batchPairs.size() < batchCount) world->batchPairs.resize(batchCount);
+    for(uint32_t batch = 0; batch < batchCount; batch++) {
+        world->batchPairs[batch].clear();
+    }
+}
+
+
+// Emits every overlapping pair once. A pair is only reported from the cell
+// holding the min corner of the overlap of both bounds, which both colliders
+// are inserted into, so no set is needed to drop duplicates across cells.
+// An oversized collider is tested against every other collider, a pair of two
+// oversized colliders is reported by the one with the lower index
+static void OversizedPairs(World *world, uint32_t i, std::vector<ColliderPair> &out) {
+    const CoreGeometry::BoundingRect &boundsA = world->bounds[i];
+    float cellSize = world->grid.cellSize;
+    uint32_t n = ColliderCount(world);
+    for(uint32_t j = 0; j < n; j++) {
+        if(j == i) continue;
+        const CoreGeometry::BoundingRect &boundsB = world->bounds[j];
+        if(!CanTouch(world->flags[i], world->flags[j])) continue;
+        if(!ShouldCollide(world, i, j)) continue;
+        if(!Overlaps(boundsA, boundsB)) continue;
+        if(j < i && CellCount(CellsOf(boundsB, cellSize)) > MAX_GRID_CELLS) continue;
+        out.push_back(ColliderPair{std::min(i, j), std::max(i, j)});
+    }
+}
+
+
+// Work items are the occupied cells followed by the oversized colliders
+static void GridPairsBatch(uint32_t batch, uint32_t begin, uint32_t end, void *context) {
+    World *world = (World*) context;
+    const SpatialGrid &grid = world->grid;
+    std::vector<ColliderPair> &out = world->batchPairs[batch];
+    uint32_t runCount = grid.runs.size() - 1;
+    for(uint32_t run = begin; run < end; run++) {
+        if(run >= runCount) {
+            OversizedPairs(world, grid.oversized[run - runCount], out);
+            continue;
+        }
+        uint32_t runStart = grid.runs[run];
+        uint32_t runEnd = grid.runs[run + 1];
+        uint64_t cell = grid.entries[runStart].cell;
+        for(uint32_t a = runStart; a < runEnd; a++) {
+            uint32_t i = grid.entries[a].collider;
+            const CoreGeometry::BoundingRect &boundsA = world->bounds[i];
+            for(uint32_t b = a + 1; b < runEnd; b++) {
+                uint32_t j = grid.entries[b].collider;
+                const CoreGeometry::BoundingRect &boundsB = world->bounds[j];
+                if(!CanTouch(world->flags[i], world->flags[j])) continue;
+                if(!ShouldCollide(world, i, j)) continue;
+                if(!Overlaps(boundsA, boundsB)) continue;
+                int32_t x = CellCoord(std::max(boundsA.bound.minX, boundsB.bound.minX), grid.cellSize);
+                int32_t y = CellCoord(std::max(boundsA.bound.minY, boundsB.bound.minY), grid.cellSize);
+                if(CellKey(x, y) != cell) continue;
+                out.push_back(ColliderPair{i, j}); // entries are sorted so i < j
+            }
+        }
+    }
+}
+
+
+static void FindGridPairs(World *world) {
+    const SpatialGrid &grid = world->grid;
+    world->pairs.clear();
+    uint32_t itemCount = grid.runs.size() - 1 + grid.oversized.size();
+    uint32_t batchCount = CoreJobs::BatchCount(itemCount, PAIR_BATCH_SIZE);
+    PrepareBatchPairs(world, batchCount);
+    CoreJobs::ParallelFor(itemCount, PAIR_BATCH_SIZE, GridPairsBatch, world);
+    MergeBatchPairs(world, batchCount);
+}
+
+
+static void TreePairsBatch(uint32_t batch, uint32_t begin, uint32_t end, void *context) {
+    World *world = (World*) context;
+    std::vector<CoreDSA::ProxyPair> &proxyPairs = world->batchProxyPairs[batch];
+    proxyPairs.clear();
+    CoreDSA::QueryPairs(world->tree, world->tree.moveBuffer.data() + begin, end - begin, proxyPairs);
+    std::vector<ColliderPair> &out = world->batchPairs[batch];
+    for(const CoreDSA::ProxyPair &pair : proxyPairs) {
+        if(!CanTouch(world->flags[pair.a], world->flags[pair.b])) continue;
+        if(!ShouldCollide(world, pair.a, pair.b)) continue;
+        out.push_back(ColliderPair{pair.a, pair.b});
+    }
+}
+
+
+// Pairs of two proxies that stayed inside their fat bounds are still valid,
+// only the moved proxies are queried against the tree. A filter change
+// touches the proxy, so kept pairs were filtered with the current bits.
+// Pairs that fell asleep are dropped, waking touches the proxy again.
+static void FindTreePairs(World *world) {
+    const CoreDSA::DynamicTree &tree = world->tree;
+    auto stale = [&](const ColliderPair &pair) {
+        return tree.nodes[world->proxies[pair.a]].moved || tree.nodes[world->proxies[pair.b]].moved
+            || !CanTouch(world->flags[pair.a], world->flags[pair.b]);
+    };
+    world->pairs.erase(std::remove_if(world->pairs.begin(), world->pairs.end(), stale), world->pairs.end());
+
+    uint32_t moved = tree.moveBuffer.size();
+    uint32_t batchCount = CoreJobs::BatchCount(moved, PAIR_BATCH_SIZE);
+    PrepareBatchPairs(world, batchCount);
+    if(world->batchProxyPairs.size() < batchCount) world->batchProxyPairs.resize(batchCount);
+    CoreJobs::ParallelFor(moved, PAIR_BATCH_SIZE, TreePairsBatch, world);
+    CoreDSA::ClearMoveBuffer(&world->tree);
+    MergeBatchPairs(world, batchCount);
+}
+
+
+static void FindPairs(World *world) {
+    world->boundsDirty = true;
+    SyncBroadphase(world);
+    if(world->broadphase == BROADPHASE_TREE) {
+        FindTreePairs(world);
+    }else{
+        FindGridPairs(world);
+    }
+}
+
+
+void CorePhysics::SetBroadphase(BroadphaseType type) {
+    World *world = CoreGlobals::physicsWorld;
+    if(world->broadphase == type) return;
+    world->broadphase = type;
+    CoreDSA::ClearTree(&world->tree);
+    world->proxies.clear();
+    world->pairs.clear();
+    world->boundsDirty = true;
+}
+
+
+void CorePhysics::SetBroadphaseCellSize(float cellSize) {
+    if(cellSize <= 0.0f) {
+        Debug::Logger("Broadphase cell size must be positive ", cellSize);
+        return;
+    }
+    CoreGlobals::physicsWorld->grid.cellSize = cellSize;
+    CoreGlobals::physicsWorld->boundsDirty = true;
+}
+
+
+void CorePhysics::SetGravity(const Vector2 &gravity) {
+    CoreGlobals::physicsWorld->gravity = gravity;
+}
+
+
+void CorePhysics::SetSolverIterations(uint32_t velocityIterations, bool warmStarting) {
+    World *world = CoreGlobals::physicsWorld;
+    world->velocityIterations = velocityIterations;
+    world->warmStarting = warmStarting;
+}
+
+
+void CorePhysics::SetFixedStep(double seconds) {
+    if(!(seconds > 0.0) || !std::isfinite(seconds)) {
+        Debug::Logger("Physics fixed step must be positive ", seconds);
+        return;
+    }
+    CoreGlobals::physicsWorld->fixedStep = seconds;
+    Debug::Logger("Physics fixed step ", seconds);
+}
+
+
+void CorePhysics::SetMaxSubsteps(uint32_t maxSubsteps) {
+    CoreGlobals::physicsWorld->maxSubsteps = std::max<uint32_t>(maxSubsteps, 1);
+}
+
+
+float CorePhysics::GetInterpolationAlpha() {
+    return CoreGlobals::physicsWorld->alpha;
+}
+
+
+/*
+ * Fixed timestep
+ * |-----------------| Frame
+ * |-----|-----|-----|-- Physics, 3 steps, the remainder stays in the accumulator
+ * Approach:
+ *  - accumulate deltaTime every frame
+ *  - run fixed steps while a whole step is accumulated, keep the remainder
+ *  - at most maxSubsteps per frame, whole steps above the cap are dropped
+ *    so a slow frame slows the simulation down instead of stalling the next one
+ *  - alpha = remainder / fixedStep, how far the frame is between the
+ *    previous and the current body state
+ * */
+static void FixedStep(World *world) {
+    float deltaTime = (float) world->fixedStep;
+    world->previousPositions = world->positions;
+    FindPairs(world);
+    NarrowphasePass(world);
+    WakePass(world);
+    EventPass(world);
+    SolvePass(world, deltaTime);
+    IntegratePass(world, deltaTime);
+    ContinuousPass(world, deltaTime);
+    SleepPass(world, deltaTime);
+    world->boundsDirty = true;
+}
+
+
+void CorePhysics::Step(double deltaTime) {
+    World *world = CoreGlobals::physicsWorld;
+    RestorePass();
+    world->accumulator += deltaTime;
+    world->events.clear();
+    world->sleptHandles.clear();
+    PullPass(world);
+
+    uint32_t substeps = 0;
+    while(world->accumulator >= world->fixedStep && substeps < world->maxSubsteps) {
+        FixedStep(world);
+        world->accumulator -= world->fixedStep;
+        substeps++;
+    }
+
+    if(world->accumulator >= world->fixedStep) {
+        uint32_t dropped = (uint32_t) (world->accumulator / world->fixedStep);
+        world->accumulator -= dropped * world->fixedStep;
+        world->droppedSteps += dropped;
+    }
+    world->alpha = (float) (world->accumulator / world->fixedStep);
+
+    SyncPass(world);
+}
+
+
+uint32_t CorePhysics::GetDroppedSteps() {
+    return CoreGlobals::physicsWorld->droppedSteps;
+}
+
+
+static void Interpolate(World *world, uint32_t i, float alpha) {
+    GameObject::Empty *owner = world->owners[i];
+    if(!owner) return;
+    const Vector2 &previous = world->previousPositions[i];
+    const Vector2 &current = world->positions[i];
+    if(previous.x == current.x && previous.y == current.y) return;
+    Vector2 offset = {(previous.x - current.x) * (1.0f - alpha), (previous.y - current.y) * (1.0f - alpha)};
+    owner->transform.pos.x += offset.x;
+    owner->transform.pos.y += offset.y;
+    SceneGraph::QueueTransform((Node2D*) owner);
+    world->interpolations.push_back(Interpolation{HandleAt(world, i), offset});
+}
+
+
+// Moves owner local positions to the pose between the previous and the
+// current step. Run after the behaviors and before the transforms are
+// propagated, so children, bounds and culling see the drawn pose.
+// Only colliders that moved in the last step have anything to blend.
+void CorePhysics::InterpolatePass() {
+    World *world = CoreGlobals::physicsWorld;
+    if(!world) return;
+    RestorePass();
+    float alpha = world->alpha;
+    for(uint32_t handle : world->awakeHandles) {
+        Interpolate(world, world->denseIndex[handle], alpha);
+    }
+    // fell asleep in the last step, possibly more than once
+    std::vector<uint32_t> &slept = world->sleptHandles;
+    std::sort(slept.begin(), slept.end());
+    slept.erase(std::unique(slept.begin(), slept.end()), slept.end());
+    for(uint32_t handle : slept) {
+        uint32_t i = DenseIndex(world, handle);
+        if(i != INVALID_INDEX && !IsAwakeDynamic(world->flags[i])) Interpolate(world, i, alpha);
+    }
+}
+
+
+// Puts the simulated positions back once the frame is drawn, game code
+// and the next pull only ever see the simulated state
+void CorePhysics::RestorePass() {
+    World *world = CoreGlobals::physicsWorld;
+    if(!world) return;
+    for(const Interpolation &interpolation : world->interpolations) {
+        uint32_t i = DenseIndex(world, interpolation.collider);
+        if(i == INVALID_INDEX || !world->owners[i]) continue;
+        GameObject::Empty *owner = world->owners[i];
+        owner->transform.pos.x -= interpolation.offset.x;
+        owner->transform.pos.y -= interpolation.offset.y;
+        SceneGraph::QueueTransform((Node2D*) owner);
+    }
+    world->interpolations.clear();
+}
+
+
+/*
+ * Snapshots
+ * A snapshot holds the arrays a step writes, copied back to back behind a
+ * small header. Shapes, handles, owners and the broadphase only change when
+ * colliders are created or destroyed, which bumps the structure version of
+ * the world. A snapshot restores into a world of the same structure version
+ * only, the bounds and the broadphase are then rebuilt from the positions.
+ * Settings and per step scratch are not saved.
+ * */
+
+
+const uint32_t SNAPSHOT_MAGIC = 0x50485953; // "PHYS"
+const uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t structureVersion;
+    uint32_t droppedSteps;
+    double accumulator;
+    float alpha;
+};
+
+
+template<typename T>
+static void WriteArray(std::vector<uint8_t> &buffer, const std::vector<T> &v) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshot arrays must be flat");
+    uint32_t count = v.size();
+    size_t offset = buffer.size();
+    buffer.resize(offset + sizeof(count) + count * sizeof(T));
+    memcpy(buffer.data() + offset, &count, sizeof(count));
+    if(count) memcpy(buffer.data() + offset + sizeof(count), v.data(), count * sizeof(T));
+}
+
+
+// Moves cursor past one array, false if the buffer ends before it does
+template<typename T>
+static bool SkipArray(const uint8_t *&cursor, const uint8_t *end, uint32_t *count) {
+    if((size_t) (end - cursor) < sizeof(*count)) return false;
+    memcpy(count, cursor, sizeof(*count));
+    cursor += sizeof(*count);
+    if((size_t) (end - cursor) < (size_t) *count * sizeof(T)) return false;
+    cursor += (size_t) *count * sizeof(T);
+    return true;
+}
+
+
+template<typename T>
+static bool ReadArray(const uint8_t *&cursor, const uint8_t *end, std::vector<T> &v) {
+    const uint8_t *start = cursor;
+    uint32_t count;
+    if(!SkipArray<T>(cursor, end, &count)) return false;
+    v.resize(count);
+    if(count) memcpy(v.data(), start + sizeof(count), count * sizeof(T));
+    return true;
+}
+
+
+// The state arrays in snapshot order, shared by save and restore
+template<typename Visitor>
+static bool VisitState(World *world, Visitor visit) {
+    return visit(world->positions)
+        && visit(world->previousPositions)
+        && visit(world->velocities)
+        && visit(world->inverseMasses)
+        && visit(world->frictions)
+        && visit(world->restitutions)
+        && visit(world->syncPositions)
+        && visit(world->syncLocals)
+        && visit(world->flags)
+        && visit(world->sleepTimers)
+        && visit(world->sleepIslands)
+        && visit(world->categories)
+        && visit(world->masks)
+        && visit(world->contacts)
+        && visit(world->touches)
+        && visit(world->wakeIslands);
+}
+
+
+void CorePhysics::SaveSnapshot(std::vector<uint8_t> &buffer) {
+    World *world = CoreGlobals::physicsWorld;
+    SnapshotHeader header = {
+        SNAPSHOT_MAGIC, SNAPSHOT_VERSION,
+        world->structureVersion, world->droppedSteps,
+        world->accumulator, world->alpha
+    };
+    buffer.resize(sizeof(header));
+    memcpy(buffer.data(), &header, sizeof(header));
+    VisitState(world, [&](auto &v) { WriteArray(buffer, v); return true; });
+}
+
+
+bool CorePhysics::RestoreSnapshot(const uint8_t *data, size_t size) {
+    World *world = CoreGlobals::physicsWorld;
+    SnapshotHeader header;
+    if(size < sizeof(header)) {
+        Debug::Logger("RestoreSnapshot: buffer too small ", (uint32_t) size);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if(header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION) {
+        Debug::Logger("RestoreSnapshot: not a physics snapshot");
+        return false;
+    }
+    if(header.structureVersion != world->structureVersion) {
+        Debug::Logger("RestoreSnapshot: colliders were created or destroyed since the snapshot");
+        return false;
+    }
+
+    // check the whole buffer first so a bad one leaves the world untouched
+    const uint8_t *end = data + size;
+    const uint8_t *cursor = data + sizeof(header);
+    bool valid = VisitState(world, [&](auto &v) {
+        uint32_t count;
+        return SkipArray<typename std::decay_t<decltype(v)>::value_type>(cursor, end, &count);
+    });
+    if(!valid) {
+        Debug::Logger("RestoreSnapshot: truncated snapshot");
+        return false;
+    }
+    cursor = data + sizeof(header);
+    VisitState(world, [&](auto &v) { return ReadArray(cursor, end, v); });
+    world->droppedSteps = header.droppedSteps;
+    world->accumulator = header.accumulator;
+    world->alpha = header.alpha;
+
+    uint32_t n = ColliderCount(world);
+    for(uint32_t i = 0; i < n; i++) {
+        // every bounds is recomputed from the restored position
+        world->flags[i] |= COLLIDER_DIRTY;
+        // owners follow the restored state, the next pull sees no move
+        GameObject::Empty *owner = world->owners[i];
+        if(owner) {
+            owner->transform.pos.x = world->syncLocals[i].x;
+            owner->transform.pos.y = world->syncLocals[i].y;
+            SceneGraph::QueueTransform((Node2D*) owner);
+        }
+    }
+    RebuildFlagLists(world);
+    // the tree is rebuilt from the new bounds, all of its pairs are found again
+    CoreDSA::ClearTree(&world->tree);
+    world->proxies.clear();
+    world->pairs.clear();
+    world->events.clear();
+    world->boundsDirty = true;
+    return true;
+}
+
+
+void CorePhysics::Resimulate(uint32_t steps, ResimulateCallback beforeStep, void *context) {
+    World *world = CoreGlobals::physicsWorld;
+    RestorePass();
+    world->events.clear();
+    world->sleptHandles.clear();
+    for(uint32_t i = 0; i < steps; i++) {
+        if(beforeStep) beforeStep(i, context);
+        PullPass(world);
+        FixedStep(world);
+    }
+    SyncPass(world);
+}
+
+
+static World* QueryWorld() {
+    World *world = CoreGlobals::physicsWorld;
+    SyncBroadphase(world);
+    // new stamp, on wrap around every collider has to be unmarked again
+    if(++world->queryStamp == 0) {
+        std::fill(world->queryStamps.begin(), world->queryStamps.end(), 0);
+        world->queryStamp = 1;
+    }
+    return world;
+}
+
+
+// Calls visit(colliderIndex) once for every collider of the run that passes the mask
+template<typename Visitor>
+static void VisitRun(World *world, uint32_t first, uint32_t categoryMask, Visitor &visit) {
+    const SpatialGrid &grid = world->grid;
+    uint64_t key = grid.entries[first].cell;
+    uint32_t count = grid.entries.size();
+    for(uint32_t i = first; i < count && grid.entries[i].cell == key; i++) {
+        uint32_t index = grid.entries[i].collider;
+        if(world->queryStamps[index] == world->queryStamp) continue;
+        world->queryStamps[index] = world->queryStamp;
+        if((world->categories[index] & categoryMask) == 0) continue;
+        visit(index);
+    }
+}
+
+
+template<typename Visitor>
+static void VisitCell(World *world, int32_t x, int32_t y, uint32_t categoryMask, Visitor &visit) {
+    uint32_t first = FindCell(world->grid, CellKey(x, y));
+    if(first != INVALID_INDEX) VisitRun(world, first, categoryMask, visit);
+}
+
+
+// Oversized colliders are in no cell, every grid query looks at them
+template<typename Visitor>
+static void VisitOversized(World *world, uint32_t categoryMask, Visitor &visit) {
+    for(uint32_t index : world->grid.oversized) {
+        if(world->categories[index] & categoryMask) visit(index);
+    }
+}
+
+
+// Tree traversal hands out proxies through a plain callback,
+// the visitor rides along in the context
+template<typename Visitor>
+struct TreeVisit {
+    World *world;
+    uint32_t categoryMask;
+    Visitor *visit;
+    float *maxDistance; // ray clip distance, raycasts only
+};
+
+
+template<typename Visitor>
+static bool TreeQueryVisit(int32_t proxy, void *context) {
+    TreeVisit<Visitor> *ctx = (TreeVisit<Visitor>*) context;
+    uint32_t index = ctx->world->tree.nodes[proxy].userData;
+    if(ctx->world->categories[index] & ctx->categoryMask) (*ctx->visit)(index);
+    return true;
+}
+
+
+template<typename Visitor>
+static float TreeRaycastVisit(
+    int32_t proxy,
+    const Vector2 &origin,
+    const Vector2 &direction,
+    float maxDistance,
+    void *context
+) {
+    TreeVisit<Visitor> *ctx = (TreeVisit<Visitor>*) context;
+    uint32_t index = ctx->world->tree.nodes[proxy].userData;
+    if(ctx->world->categories[index] & ctx->categoryMask) (*ctx->visit)(index);
+    return *ctx->maxDistance;
+}
+
+
+/*
+ * Grid: walks the cells along the ray (Amanatides & Woo) after clipping it
+ * to the occupied extent. With closestOnly the walk stops as soon as the
+ * best hit lies inside the cells already visited.
+ * Tree: the best hit so far clips the ray for the rest of the traversal.
+ * */
+static uint32_t CastRay(
+    const Vector2 &origin, const Vector2 &direction, float maxDistance,
+    uint32_t categoryMask, bool closestOnly,
+    RaycastHit *closest, std::vector<RaycastHit> *all
+) {
+    float length = CoreMath::Length(direction);
+    if(length <= 0.0f || ColliderCount(CoreGlobals::physicsWorld) == 0) return 0;
+    Vector2 d = CoreMath::VectorMul(direction, 1.0f / length);
+
+    World *world = QueryWorld();
+    uint32_t hitCount = 0;
+    float best = maxDistance;
+    auto test = [&](uint32_t index) {
+        float distance;
+        Vector2 normal;
+        if(!CoreGeometry::Raycast(
+            world->shapes[index], ColliderTransform(world, index),
+            origin, d, closestOnly ? best : maxDistance,
+            &distance, &normal
+            )) return;
+        RaycastHit hit;
+        hit.collider = HandleAt(world, index);
+        hit.owner = world->owners[index];
+        hit.distance = distance;
+        hit.point = CoreMath::VectorAdd(origin, CoreMath::VectorMul(d, distance));
+        hit.normal = normal;
+        hitCount++;
+        if(all) all->push_back(hit);
+        if(closest && distance <= best) {
+            best = distance;
+            *closest = hit;
+        }
+    };
+
+    if(world->broadphase == BROADPHASE_TREE) {
+        float clip = maxDistance;
+        TreeVisit<decltype(test)> ctx = {world, categoryMask, &test, closestOnly ? &best : &clip};
+        CoreDSA::Raycast(world->tree, origin, d, maxDistance, TreeRaycastVisit<decltype(test)>, &ctx);
+        return hitCount;
+    }
+
+    const SpatialGrid &grid = world->grid;
+    VisitOversized(world, categoryMask, test);
+
+    // slab test against the grid extent
+    float tEnter = 0.0f;
+    float tExit = maxDistance;
+    const float o[2] = {origin.x, origin.y};
+    const float dir[2] = {d.x, d.y};
+    const float lo[2] = {grid.extent.bound.minX, grid.extent.bound.minY};
+    const float hi[2] = {grid.extent.bound.maxX, grid.extent.bound.maxY};
+    for(int axis = 0; axis < 2; axis++) {
+        if(dir[axis] == 0.0f) {
+            if(o[axis] < lo[axis] || o[axis] > hi[axis]) return 0;
+            continue;
+        }
+        float t1 = (lo[axis] - o[axis]) / dir[axis];
+        float t2 = (hi[axis] - o[axis]) / dir[axis];
+        tEnter = std::max(tEnter, std::min(t1, t2));
+        tExit = std::min(tExit, std::max(t1, t2));
+    }
+    if(tEnter > tExit) return 0;
+
+    float cellSize = grid.cellSize;
+    Vector2 start = CoreMath::VectorAdd(origin, CoreMath::VectorMul(d, tEnter));
+    int32_t x = CellCoord(start.x, cellSize);
+    int32_t y = CellCoord(start.y, cellSize);
+    int32_t stepX = d.x > 0.0f ? 1 : -1;
+    int32_t stepY = d.y > 0.0f ? 1 : -1;
+    float tMaxX = d.x != 0.0f ? tEnter + ((x + (stepX > 0)) * cellSize - start.x) / d.x : FLT_MAX;
+    float tMaxY = d.y != 0.0f ? tEnter + ((y + (stepY > 0)) * cellSize - start.y) / d.y : FLT_MAX;
+    float tDeltaX = d.x != 0.0f ? cellSize / std::fabs(d.x) : FLT_MAX;
+    float tDeltaY = d.y != 0.0f ? cellSize / std::fabs(d.y) : FLT_MAX;
+
+    float t = tEnter;
+    while(t <= tExit) {
+        VisitCell(world, x, y, categoryMask, test);
+        float cellExit = std::min(tMaxX, tMaxY);
+        if(closestOnly && hitCount > 0 && best <= cellExit) break;
+        if(tMaxX < tMaxY) {
+            x += stepX;
+            t = tMaxX;
+            tMaxX += tDeltaX;
+        }else{
+            y += stepY;
+            t = tMaxY;
+            tMaxY += tDeltaY;
+        }
+    }
+    return hitCount;
+}
+
+
+bool CorePhysics::Raycast(
+    const Vector2 &origin,
+    const Vector2 &direction,
+    float maxDistance,
+    RaycastHit *hit,
+    uint32_t categoryMask
+) {
+    return CastRay(origin, direction, maxDistance, categoryMask, true, hit, nullptr) > 0;
+}
+
+
+uint32_t CorePhysics::RaycastAll(
+    const Vector2 &origin,
+    const Vector2 &direction,
+    float maxDistance,
+    std::vector<RaycastHit> &hits,
+    uint32_t categoryMask
+) {
+    hits.clear();
+    CastRay(origin, direction, maxDistance, categoryMask, false, nullptr, &hits);
+    std::sort(hits.begin(), hits.end(), [](const RaycastHit &a, const RaycastHit &b) {
+        return a.distance < b.distance;
+    });
+    return hits.size();
+}
+
+
+// Narrowphase against a query shape, result order only depends on the world contents
+static uint32_t OverlapShape(
+    const CoreGeometry::Shape &shape,
+    const CoreGeometry::BoundingRect &rect,
+    std::vector<ColliderHandle> &results,
+    uint32_t categoryMask
+) {
+    results.clear();
+    if(ColliderCount(CoreGlobals::physicsWorld) == 0) return 0;
+    World *world = QueryWorld();
+    Affine2D identity = CoreMath::IdentityAffine2D();
+    auto test = [&](uint32_t index) {
+        if(!Overlaps(world->bounds[index], rect)) return;
+        CoreGeometry::Manifold manifold;
+        if(CoreGeometry::Collide(shape, identity, world->shapes[index], ColliderTransform(world, index), &manifold)) {
+            results.push_back(HandleAt(world, index));
+        }
+    };
+
+    if(world->broadphase == BROADPHASE_TREE) {
+        TreeVisit<decltype(test)> ctx = {world, categoryMask, &test, nullptr};
+        CoreDSA::Query(world->tree, rect, TreeQueryVisit<decltype(test)>, &ctx);
+        return results.size();
+    }
+
+    const SpatialGrid &grid = world->grid;
+    VisitOversized(world, categoryMask, test);
+
+    // only cells inside the occupied extent can hold anything
+    CellRange r = CellsOf(rect, grid.cellSize);
+    CellRange limit = CellsOf(grid.extent, grid.cellSize);
+    r.x0 = std::max(r.x0, limit.x0);
+    r.y0 = std::max(r.y0, limit.y0);
+    r.x1 = std::min(r.x1, limit.x1);
+    r.y1 = std::min(r.y1, limit.y1);
+    uint64_t cellCount = CellCount(r);
+    uint32_t runCount = grid.runs.size() - 1;
+    if(cellCount > runCount) {
+        // fewer occupied cells than cells in the range, walk the occupied ones
+        for(uint32_t run = 0; run < runCount; run++) {
+            uint64_t key = grid.entries[grid.runs[run]].cell;
+            int32_t x = (int32_t) (uint32_t) (key >> 32);
+            int32_t y = (int32_t) (uint32_t) key;
+            if(x < r.x0 || x > r.x1 || y < r.y0 || y > r.y1) continue;
+            VisitRun(world, grid.runs[run], categoryMask, test);
+        }
+        return results.size();
+    }
+    for(int32_t y = r.y0; y <= r.y1; y++) {
+        for(int32_t x = r.x0; x <= r.x1; x++) {
+            VisitCell(world, x, y, categoryMask, test);
+        }
+    }
+    return results.size();
+}
+
+
+uint32_t CorePhysics::OverlapAABB(
+    const CoreGeometry::BoundingRect &rect,
+    std::vector<ColliderHandle> &results,
+    uint32_t categoryMask
+) {
+    CoreGeometry::Shape box = CoreGeometry::CreateBox(
+        Vector2{(rect.bound.maxX - rect.bound.minX) * 0.5f, (rect.bound.maxY - rect.bound.minY) * 0.5f},
+        Vector2{(rect.bound.maxX + rect.bound.minX) * 0.5f, (rect.bound.maxY + rect.bound.minY) * 0.5f}
+        );
+    return OverlapShape(box, rect, results, categoryMask);
+}
+
+
+uint32_t CorePhysics::OverlapPoint(
+    const Vector2 &point,
+    std::vector<ColliderHandle> &results,
+    uint32_t categoryMask
+) {
+    CoreGeometry::BoundingRect rect;
+    rect.bound = {point.x, point.y, point.x, point.y};
+    return OverlapShape(CoreGeometry::CreateCircle(point, 0.0f), rect, results, categoryMask);
+}
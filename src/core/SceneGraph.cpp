@@ -1,11 +1,11 @@
 #include <core/CoreGlobals.h>
 #include <core/SceneGraph.h>
 #include <core/Physics.fwd.h>
+#include <core/Jobs.h>
 #include <platform/Graphics.h>
 #include <stdexcept>
 #include <utils/RUID.h>
-#include <stack>
-#include <set>
+#include <algorithm>
 #include <unordered_map>
 #include <utils/Debug.h>
 
@@ -28,32 +28,169 @@ Node2D* SceneGraph::GetSceneRoot(Scene **scene) {
 }
 
 
+/*
+ * Hierarchy
+ * */
+
+
+// Appends node and its subtree in pre-order, last child first
+static void AppendSubtree(Hierarchy &hierarchy, Node2D *node, int32_t parent) {
+    uint32_t index = hierarchy.nodes.size();
+    hierarchy.nodes.push_back(node);
+    hierarchy.parents.push_back(parent);
+    hierarchy.subtreeSizes.push_back(1);
+    for(auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+        AppendSubtree(hierarchy, *it, (int32_t) index);
+    }
+    hierarchy.subtreeSizes[index] = hierarchy.nodes.size() - index;
+}
+
+
+static void UpdateSceneIndices(Scene *scene, uint32_t from) {
+    Hierarchy &hierarchy = scene->hierarchy;
+    for(uint32_t i = from; i < hierarchy.nodes.size(); i++) {
+        hierarchy.nodes[i]->sceneIndex = (int32_t) i;
+        hierarchy.nodes[i]->scene = scene;
+    }
+    scene->structureChanged = true;
+}
+
+
+// The whole scene is recomputed by the first UpdatePass
+static void BuildHierarchy(Scene *scene) {
+    Hierarchy &hierarchy = scene->hierarchy;
+    hierarchy.nodes.clear();
+    hierarchy.parents.clear();
+    hierarchy.subtreeSizes.clear();
+    AppendSubtree(hierarchy, scene->sceneRoot, -1);
+    UpdateSceneIndices(scene, 0);
+    QueueTransform(scene->sceneRoot);
+}
+
+
+// Inserts the subtree of child right after its parent, as its first stored child
+static void SpliceSubtree(Scene *scene, Node2D *child, int32_t parent) {
+    Hierarchy &hierarchy = scene->hierarchy;
+    Hierarchy &subtree = scene->spliceScratch;
+    subtree.nodes.clear();
+    subtree.parents.clear();
+    subtree.subtreeSizes.clear();
+    AppendSubtree(subtree, child, -1);
+
+    int32_t at = parent + 1;
+    int32_t count = (int32_t) subtree.nodes.size();
+    for(uint32_t i = at; i < hierarchy.parents.size(); i++) {
+        if(hierarchy.parents[i] >= at) hierarchy.parents[i] += count;
+    }
+    for(int32_t &p : subtree.parents) {
+        p = p < 0 ? parent : p + at;
+    }
+    hierarchy.nodes.insert(hierarchy.nodes.begin() + at, subtree.nodes.begin(), subtree.nodes.end());
+    hierarchy.parents.insert(hierarchy.parents.begin() + at, subtree.parents.begin(), subtree.parents.end());
+    hierarchy.subtreeSizes.insert(hierarchy.subtreeSizes.begin() + at, subtree.subtreeSizes.begin(), subtree.subtreeSizes.end());
+    for(int32_t a = parent; a >= 0; a = hierarchy.parents[a]) {
+        hierarchy.subtreeSizes[a] += count;
+    }
+    UpdateSceneIndices(scene, at);
+}
+
+
+// Geometry of nodes that are culled and drawn, nullptr for the others
+static GameObject::Geometry2D* DrawableGeometry(Node2D *node) {
+    switch(node->type){
+        case GameObject::Type::SPRITE : return &reinterpret_cast<Sprite*>(node)->geometry;
+        case GameObject::Type::ANIMATED_SPRITE : return &reinterpret_cast<AnimatedSprite*>(node)->sprite.geometry;
+        case GameObject::Type::TEXT : return &reinterpret_cast<Text*>(node)->geometry;
+        default : return nullptr;
+    }
+}
+
+
+static void RemoveFromIndex(Scene *scene, Node2D *node) {
+    GameObject::Geometry2D *geometry = DrawableGeometry(node);
+    if(!geometry || geometry->proxy < 0) return;
+    CoreDSA::DestroyProxy(&scene->spatialIndex, geometry->proxy);
+    scene->indexedNodes[geometry->proxy] = nullptr;
+    geometry->proxy = -1;
+}
+
+
+// Removed nodes also leave the dirty list, they may be deleted before the next pass
+static void RemoveSubtree(Scene *scene, int32_t index) {
+    Hierarchy &hierarchy = scene->hierarchy;
+    int32_t count = (int32_t) hierarchy.subtreeSizes[index];
+    for(int32_t a = hierarchy.parents[index]; a >= 0; a = hierarchy.parents[a]) {
+        hierarchy.subtreeSizes[a] -= count;
+    }
+    for(int32_t i = index; i < index + count; i++) {
+        Node2D *node = hierarchy.nodes[i];
+        node->sceneIndex = -1;
+        node->scene = nullptr;
+        reinterpret_cast<Empty*>(node)->transform.queued = false;
+        RemoveFromIndex(scene, node);
+    }
+    std::vector<Node2D*> &dirty = scene->dirtyNodes;
+    dirty.erase(std::remove_if(dirty.begin(), dirty.end(), [scene](Node2D *node) {
+        return node->scene != scene;
+    }), dirty.end());
+    hierarchy.nodes.erase(hierarchy.nodes.begin() + index, hierarchy.nodes.begin() + index + count);
+    hierarchy.parents.erase(hierarchy.parents.begin() + index, hierarchy.parents.begin() + index + count);
+    hierarchy.subtreeSizes.erase(hierarchy.subtreeSizes.begin() + index, hierarchy.subtreeSizes.begin() + index + count);
+    for(uint32_t i = index; i < hierarchy.parents.size(); i++) {
+        if(hierarchy.parents[i] >= index + count) hierarchy.parents[i] -= count;
+    }
+    UpdateSceneIndices(scene, index);
+}
+
+
+// The child is marked once spliced, so a scene queues the whole subtree
 bool SceneGraph::AttachTo(Node2D *parent, Node2D *child){
+    if(child->parent) Detach(child);
     (parent)->children.push_back(child);
     child->parent = parent;
+    if(parent->scene) {
+        SpliceSubtree(parent->scene, child, parent->sceneIndex);
+    }
+    GameObject::MarkTransformDirty(child);
+    return true;
+}
+
+
+bool SceneGraph::Detach(Node2D *child) {
+    Node2D *parent = child->parent;
+    if(!parent) return false;
+    auto &siblings = parent->children;
+    siblings.erase(std::remove(siblings.begin(), siblings.end(), child), siblings.end());
+    child->parent = nullptr;
+    if(child->scene) {
+        RemoveSubtree(child->scene, child->sceneIndex);
+    }
+    GameObject::MarkTransformDirty(child);
     return true;
 }
 
 
+bool SceneGraph::RemoveFromScene(Node2D *node) {
+    Scene *scene = node->scene;
+    if(!scene) return false;
+    if(node == scene->sceneRoot) scene->sceneRoot = nullptr;
+    RemoveSubtree(scene, node->sceneIndex);
+    return true;
+}
+
+
+// Behaviors may attach or detach nodes while a pass walks the hierarchy,
+// the walk continues after wherever the current node ended up
+static inline uint32_t NextIndex(Node2D *current, uint32_t index) {
+    return current->sceneIndex >= 0 ? (uint32_t) current->sceneIndex + 1 : index;
+}
+
+
 std::vector<Node2D*> SceneGraph::GetSceneNodesByName(Scene **scene, std::string name) {
     std::vector<Node2D*> found;
-    std::stack<Node2D*> stack;
-    std::set<Node2D*> visited;
-    stack.push((*scene)->sceneRoot);
-    while(!stack.empty()){
-        Node2D* current = stack.top();
-        stack.pop();
-        auto it = visited.find(current);
-        if(it == visited.end()){
-            visited.insert(current);
-            if(current->name == name) {
-                found.push_back(current);
-            }
-            stack.push(current);
-            for(auto it = current->children.begin(); it != current->children.end(); ++it){
-                Node2D* child = (Node2D*) *it;
-                stack.push(child);
-            }
+    for(Node2D *current : (*scene)->hierarchy.nodes) {
+        if(current->name == name) {
+            found.push_back(current);
         }
     }
     return found;
@@ -81,6 +218,7 @@ Scene* SceneGraph::CreateScene(std::string name, Camera *activeCamera, Node2D* r
         }
         scenes[newScene->id] = newScene;
         _scenes[newScene->name] = newScene;
+        BuildHierarchy(newScene);
         // CoreGlobals::gameObjectNameToID[newScene->name] = newScene->id;
         return newScene;
     }catch(const std::exception &e) {
@@ -100,171 +238,427 @@ Scene* SceneGraph::GetSceneByName(std::string name) {
 
 
 void SceneGraph::InitPass(Scene *scene) {
-    Node2D* root = scene->sceneRoot;
-    std::stack<Node2D *> stack;
-    std::set<Node2D *> visited;
-    stack.push(root);
-
-    while(!stack.empty()){
-        Node2D* current = stack.top();
-        stack.pop();
-        auto it = visited.find(current);
-        if(it == visited.end()){
-            if(current->behavior.DeSerialize) {
-                current->behavior.DeSerialize(current);
-            }
+    std::vector<Node2D*> &nodes = scene->hierarchy.nodes;
+    for(uint32_t i = 0; i < nodes.size(); ) {
+        Node2D* current = nodes[i];
+        if(current->behavior.DeSerialize) {
+            current->behavior.DeSerialize(current);
+        }
 
-            if(current->behavior.Start) {
-                current->behavior.Start(current);
-            }
-            visited.insert(current);
-            for(auto it = current->children.begin(); it != current->children.end(); ++it){
-                Node2D* child = (Node2D*) *it;
-                stack.push(child);
+        if(current->behavior.Start) {
+            current->behavior.Start(current);
+        }
+        i = NextIndex(current, i);
+    }
+}
+
+
+/*
+ * Draw order
+ * */
+
+
+static inline uint64_t SortBits(uint32_t value, uint32_t bits) {
+    return (uint64_t) std::min<uint32_t>(value, (1u << bits) - 1);
+}
+
+
+static inline uint32_t ResourceSortId(const GameResource::Resource *resource) {
+    return resource ? resource->sortId : 0;
+}
+
+
+uint64_t SceneGraph::MakeDrawKey(Node2D *node) {
+    const GameResource::Material *material = nullptr;
+    const GameResource::Resource *texture = nullptr;
+    float z = 0.0f;
+    switch(node->type) {
+        case GameObject::Type::SPRITE :
+        {
+            Sprite *sp = reinterpret_cast<Sprite*>(node);
+            material = sp->material;
+            z = sp->transform.worldPos.z;
+            break;
+        }
+        case GameObject::Type::ANIMATED_SPRITE :
+        {
+            AnimatedSprite *as = reinterpret_cast<AnimatedSprite*>(node);
+            material = as->sprite.material;
+            z = as->sprite.transform.worldPos.z;
+            break;
+        }
+        case GameObject::Type::TEXT :
+        {
+            Text *text = reinterpret_cast<Text*>(node);
+            texture = text->font;
+            z = text->transform.worldPos.z;
+            break;
+        }
+        default : break;
+    }
+    if(material) texture = material->mainTexture;
+
+    int32_t zIndex = std::clamp(node->zIndex, (int) INT16_MIN, (int) INT16_MAX) + 0x8000;
+    uint32_t depth = (uint32_t) std::clamp(z, 0.0f, 255.0f);
+    return ((uint64_t) node->layer << 56)
+        | ((uint64_t) zIndex << 40)
+        | (SortBits(ResourceSortId(material ? material->shader : nullptr), 10) << 30)
+        | (SortBits(ResourceSortId(material), 12) << 18)
+        | (SortBits(ResourceSortId(texture), 10) << 8)
+        | (uint64_t) depth;
+}
+
+
+/*
+ * Update spans
+ * Transforms, bounds and visibility of the engine owned node data run on
+ * the job workers, user behaviors stay on the calling thread.
+ * */
+
+
+const uint32_t SPAN_SIZE = 256; // target nodes per parallel span
+
+
+static UpdateSpan& OpenSpan(Scene *scene, uint32_t begin, uint32_t end, bool head) {
+    if(scene->spanCount == scene->spans.size()) {
+        scene->spans.emplace_back();
+    }
+    UpdateSpan &span = scene->spans[scene->spanCount++];
+    span.begin = begin;
+    span.end = end;
+    span.head = head;
+    span.frame = 0;
+    return span;
+}
+
+
+// Walks the hierarchy skipping over subtrees that fit in a span,
+// adjacent small subtrees share a span
+static void BuildSpans(Scene *scene) {
+    Hierarchy &hierarchy = scene->hierarchy;
+    scene->spanCount = 0;
+    UpdateSpan *open = nullptr;
+    uint32_t n = (uint32_t) hierarchy.nodes.size();
+    for(uint32_t i = 0; i < n; ) {
+        uint32_t size = hierarchy.subtreeSizes[i];
+        if(size > SPAN_SIZE) {
+            OpenSpan(scene, i, i + 1, true);
+            open = nullptr;
+            i++;
+            continue;
+        }
+        if(open && open->end == i && open->end - open->begin + size <= SPAN_SIZE) {
+            open->end += size;
+        }else{
+            open = &OpenSpan(scene, i, i + size, false);
+        }
+        i += size;
+    }
+}
+
+
+// Caches of the hierarchy structure, rebuilt only after it changed
+static void RefreshStructure(Scene *scene) {
+    if(!scene->structureChanged) return;
+    BuildSpans(scene);
+    scene->cameras.clear();
+    scene->updatables.clear();
+    for(Node2D *current : scene->hierarchy.nodes) {
+        if(current->type == GameObject::Type::CAMERA) {
+            scene->cameras.push_back(reinterpret_cast<Camera*>(current));
+        }
+        if(current->behavior.Update) {
+            scene->updatables.push_back(current);
+        }
+    }
+    scene->structureChanged = false;
+}
+
+
+// Behaviors may attach or detach nodes, the walk then continues after
+// wherever the current node ended up, same as NextIndex over the hierarchy
+static uint32_t NextUpdatable(Scene *scene, Node2D *current, uint32_t index, uint32_t u) {
+    if(!scene->structureChanged) return u + 1;
+    RefreshStructure(scene);
+    uint32_t next = current->scene == scene ? (uint32_t) current->sceneIndex + 1 : index;
+    auto it = std::lower_bound(
+        scene->updatables.begin(), scene->updatables.end(), next,
+        [](Node2D *node, uint32_t i) { return (uint32_t) node->sceneIndex < i; }
+        );
+    return (uint32_t) (it - scene->updatables.begin());
+}
+
+
+void SceneGraph::QueueTransform(Node2D *node) {
+    GameObject::Transform2D *transform = &reinterpret_cast<Empty*>(node)->transform;
+    transform->dirty = true;
+    if(node->scene && !transform->queued) {
+        transform->queued = true;
+        node->scene->dirtyNodes.push_back(node);
+    }
+}
+
+
+// Turns the dirty list into the subtrees to recompute, a dirty node under
+// an earlier dirty node is already covered. Each subtree is split over the
+// spans it crosses, the spans it touches become active for the frame.
+static void GatherDirtyRanges(Scene *scene) {
+    Hierarchy &hierarchy = scene->hierarchy;
+    std::vector<uint32_t> &roots = scene->dirtyRoots;
+    roots.clear();
+    for(Node2D *node : scene->dirtyNodes) {
+        reinterpret_cast<Empty*>(node)->transform.queued = false;
+        roots.push_back((uint32_t) node->sceneIndex);
+    }
+    scene->dirtyNodes.clear();
+    std::sort(roots.begin(), roots.end());
+
+    scene->activeSpans.clear();
+    UpdateSpan *spans = scene->spans.data();
+    uint32_t spanCount = scene->spanCount;
+    uint32_t covered = 0;
+    for(uint32_t root : roots) {
+        if(root < covered) continue;
+        covered = root + hierarchy.subtreeSizes[root];
+        // spans tile the hierarchy, the first one crossed is the last to begin at or before root
+        uint32_t s = (uint32_t) (std::upper_bound(spans, spans + spanCount, root,
+            [](uint32_t i, const UpdateSpan &span) { return i < span.begin; }) - spans) - 1;
+        for(; s < spanCount && spans[s].begin < covered; s++) {
+            UpdateSpan &span = spans[s];
+            if(span.frame != scene->frame) {
+                span.frame = scene->frame;
+                span.ranges.clear();
+                scene->activeSpans.push_back(s);
             }
+            span.ranges.push_back(std::max(root, span.begin));
+            span.ranges.push_back(std::min(covered, span.end));
         }
     }
 }
 
 
-void SceneGraph::UpdatePass(Scene *scene, unsigned int fps, double deltaTime) {
-    Node2D* root = scene->sceneRoot;
-    CoreGeometry::BoundingRect *frustum = &(scene->activeCamera->geometry.AABB);
-    std::stack<Node2D *> stack;
-    std::set<Node2D *> visited;
-    stack.push(root);
-
-    while(!stack.empty()){
-        Node2D* current = stack.top();
-        stack.pop();
-        auto it = visited.find(current);
-        if(it == visited.end()){
+// Every node of a dirty range is recomputed, its parent is either before
+// it in the span or a head, both already up to date
+static void UpdateSpanNodes(Scene *scene, UpdateSpan &span) {
+    span.transformsUpdated = 0;
+    span.dirtyNodes.clear();
+    span.dirtyGeometry.clear();
+    span.transforms.clear();
+    span.halfExtents.clear();
+
+    for(uint32_t r = 0; r < span.ranges.size(); r += 2) {
+        for(uint32_t i = span.ranges[r]; i < span.ranges[r + 1]; i++) {
+            Node2D* current = scene->hierarchy.nodes[i];
             GameObject::Empty *renderable = reinterpret_cast<Empty*>(current);
-            CoreMath::Matrix S = CoreMath::CreateScaleMatrix(renderable->transform.scale);
-            CoreMath::Matrix R = CoreMath::CreateZRotationMatrix(renderable->transform.rotation);
-            CoreMath::Matrix T = CoreMath::CreateTranslationMatrix(renderable->transform.pos.xy);
-            // renderable->transform.Local = CoreMath::Multiply(CoreMath::Multiply(R, T), S); 
-            renderable->transform.Local = CoreMath::Multiply(T, CoreMath::Multiply(R, S)); 
-
-            if(renderable->attribute.parent){
-                GameObject::Empty *parent = reinterpret_cast<Empty*>(current->parent);
+            GameObject::Transform2D *transform = &renderable->transform;
+            GameObject::Empty *parent = reinterpret_cast<Empty*>(current->parent);
+            if(transform->rotation != transform->cachedRotation) {
+                CoreMath::SinCos(
+                    transform->rotation * (float) (PI / 180),
+                    &transform->sinRotation,
+                    &transform->cosRotation
+                    );
+                transform->cachedRotation = transform->rotation;
+            }
+            transform->Local = CoreMath::CreateAffine2D(
+                transform->pos.xy,
+                transform->scale,
+                transform->sinRotation,
+                transform->cosRotation
+                );
+
+            if(parent){
                 renderable->transform.World = CoreMath::Multiply(
                     parent->transform.World,
                     renderable->transform.Local
                     );
-                renderable->transform.worldPos = CoreMath::VectorAdd(parent->transform.worldPos, renderable->transform.pos);
-                Debug::Logger("World POS 1 = ", VectorToString(renderable->transform.worldPos));
-                renderable->transform.worldPos = CoreMath::Multiply(T, renderable->transform.pos);
-                Debug::Logger("World POS 2 = ", VectorToString(renderable->transform.worldPos));
             }else{
                 renderable->transform.World = renderable->transform.Local;
-                renderable->transform.worldPos = renderable->transform.pos;
             }
-
-            switch(current->type){
-                case GameObject::Type::SPRITE : 
-                {
-                    Sprite *sp = reinterpret_cast<Sprite*>(current);
-                    CoreGeometry::UpdateAABB(
-                        &sp->geometry.AABB, 
-                        sp->geometry.vertices,
-                        renderable->transform.World
-                        );
-                    CorePhysics::BoxCollider *spCollider = (CorePhysics::BoxCollider*) sp->collider;
-                    spCollider->AABB = sp->geometry.AABB;
-                    if(CoreGeometry::Intersect(frustum, &sp->geometry.AABB)) {
-                        scene->drawable.push_back(current);
-                    }
-                    break;
-                }
-                case GameObject::Type::ANIMATED_SPRITE : 
-                {
-                    AnimatedSprite *as = reinterpret_cast<AnimatedSprite*>(current);
-                    Sprite *sp = &as->sprite;
-                    CoreGeometry::UpdateAABB(
-                        &sp->geometry.AABB, 
-                        sp->geometry.vertices,
-                        renderable->transform.World
-                        );
-                    if(CoreGeometry::Intersect(frustum, &sp->geometry.AABB)) {
-                        scene->drawable.push_back(current);
-                    }
-                    break;
-                }
-                case GameObject::Type::TEXT : 
-                {
-                    Text *text = reinterpret_cast<Text*>(current);
-                    CoreGeometry::UpdateAABB(
-                        &text->geometry.AABB, 
-                        text->geometry.vertices,
-                        renderable->transform.World
-                        );
-                    if(CoreGeometry::Intersect(frustum, &text->geometry.AABB)) {
-                        scene->drawable.push_back(current);
-                    }
-                    break;
-                }
-                case GameObject::Type::CAMERA : 
-                {
-                    Camera *cm = reinterpret_cast<Camera*>(current);
-                    Vector2 zoom = Vector2{cm->transform.pos.z, cm->transform.pos.z};
-                    CoreGeometry::UpdateAABB(
-                        &cm->geometry.AABB, 
-                        cm->geometry.vertices,
-                        CoreMath::Multiply(T, CoreMath::CreateScaleMatrix(zoom)) 
-                        );
-                    cm->up = CoreMath::Multiply(R, Vector4{0.0f, 1.0f, 0.0f, 0.0f});
-                    cm->view = CoreMath::ViewSpaceMatrix(cm->transform.pos, cm->up);
-                    if(scene->activeCamera == cm) {
-                        Graphics::UpdateViewProjectionMatrix(cm);
-                        scene->drawable.push_back(current);
-                    }
-                    break;
-                }
-                default : break;
+            renderable->transform.worldPos = Vector4{
+                renderable->transform.World.m13,
+                renderable->transform.World.m23,
+                renderable->transform.pos.z,
+                1.0f
+            };
+            transform->dirty = false;
+            transform->updatedFrame = scene->frame;
+            span.transformsUpdated++;
+
+            GameObject::Geometry2D *geometry = DrawableGeometry(current);
+            if(geometry) {
+                span.dirtyNodes.push_back(current);
+                span.dirtyGeometry.push_back(geometry);
+                span.transforms.push_back(renderable->transform.World);
+                span.halfExtents.push_back(geometry->halfExtents);
             }
+        }
+    }
+
+    uint32_t dirty = (uint32_t) span.dirtyGeometry.size();
+    span.dirtyBounds.resize(dirty);
+    span.displacements.resize(dirty);
+    CoreGeometry::UpdateAABBs(
+        span.dirtyBounds.data(),
+        span.halfExtents.data(),
+        span.transforms.data(),
+        dirty
+        );
+    for(uint32_t i = 0; i < dirty; i++) {
+        const CoreGeometry::BoundingRect &b = span.dirtyBounds[i];
+        const CoreGeometry::BoundingRect &p = span.dirtyGeometry[i]->AABB;
+        span.displacements[i] = Vector2{
+            (b.bound.minX + b.bound.maxX - p.bound.minX - p.bound.maxX) * 0.5f,
+            (b.bound.minY + b.bound.maxY - p.bound.minY - p.bound.maxY) * 0.5f
+        };
+        span.dirtyGeometry[i]->AABB = b;
+    }
+}
+
+
+static void UpdateSpanBatch(uint32_t batch, uint32_t begin, uint32_t end, void *context) {
+    Scene *scene = (Scene*) context;
+    for(uint32_t i = begin; i < end; i++) {
+        UpdateSpan &span = scene->spans[scene->activeSpans[i]];
+        if(!span.head) UpdateSpanNodes(scene, span);
+    }
+}
+
+
+// Camera bounds only depend on the local position, the culling spans need them
+static void UpdateCameraBounds(Scene *scene) {
+    for(Camera *cm : scene->cameras) {
+        Vector2 zoom = Vector2{cm->transform.pos.z, cm->transform.pos.z};
+        CoreGeometry::UpdateAABB(
+            &cm->geometry.AABB, 
+            cm->geometry.halfExtents,
+            CoreMath::CreateAffine2D(cm->transform.pos.xy, zoom, 0.0f, 1.0f)
+            );
+    }
+}
+
+
+// The view needs the rotation cached by the transform update
+static void UpdateCameraViews(Scene *scene) {
+    for(Camera *cm : scene->cameras) {
+        // rotated (0, 1)
+        cm->up = Vector4{cm->transform.sinRotation, cm->transform.cosRotation, 0.0f, 0.0f};
+        cm->view = CoreMath::ViewSpaceMatrix(cm->transform.pos, cm->up);
+        if(scene->activeCamera == cm) {
+            Graphics::UpdateViewProjectionMatrix(cm);
+        }
+    }
+}
 
-            if(current->behavior.Update) {
-                current->behavior.Update(current, fps, deltaTime);
-            }
 
-            visited.insert(current);
-            for(auto it = current->children.begin(); it != current->children.end(); ++it){
-                Node2D* child = (Node2D*) *it;
-                stack.push(child);
+// Moves the index leaves of drawables that moved, new drawables get one.
+// Leaves stay put while the tight bounds are inside their fat bounds.
+static void UpdateSpatialIndex(Scene *scene) {
+    CoreDSA::DynamicTree &tree = scene->spatialIndex;
+    for(uint32_t s : scene->activeSpans) {
+        UpdateSpan &span = scene->spans[s];
+        scene->transformsUpdated += span.transformsUpdated;
+        for(uint32_t i = 0; i < span.dirtyNodes.size(); i++) {
+            GameObject::Geometry2D *geometry = span.dirtyGeometry[i];
+            if(geometry->proxy >= 0) {
+                CoreDSA::MoveProxy(&tree, geometry->proxy, geometry->AABB, span.displacements[i]);
+                continue;
             }
+            geometry->proxy = CoreDSA::CreateProxy(&tree, geometry->AABB, 0);
+            if(scene->indexedNodes.size() < tree.nodes.size()) {
+                scene->indexedNodes.resize(tree.nodes.size(), nullptr);
+            }
+            scene->indexedNodes[geometry->proxy] = span.dirtyNodes[i];
         }
     }
+    // the scene index never asks for pairs
+    CoreDSA::ClearMoveBuffer(&tree);
+}
 
-    // SortSceneDrawable(scene->drawable);
-    
+
+static bool CollectCandidate(int32_t proxy, void *context) {
+    Scene *scene = (Scene*) context;
+    Node2D *node = scene->indexedNodes[proxy];
+    scene->candidates.push_back(node);
+    scene->candidateBounds.push_back(DrawableGeometry(node)->AABB);
+    return true;
+}
+
+
+// Index hits are tested again against their tight bounds, leaves are fat
+static void CullPass(Scene *scene) {
+    scene->candidates.clear();
+    scene->candidateBounds.clear();
+    CoreDSA::Query(scene->spatialIndex, scene->activeCamera->geometry.AABB, CollectCandidate, scene);
+
+    uint32_t count = (uint32_t) scene->candidates.size();
+    scene->visible.resize(count);
+    uint32_t visible = CoreGeometry::CullAABBs(
+        scene->activeCamera->geometry.AABB,
+        scene->candidateBounds.data(),
+        count,
+        scene->visible.data()
+        );
+
+    scene->drawKeys.resize(visible);
+    for(uint32_t i = 0; i < visible; i++) {
+        Node2D *node = scene->candidates[scene->visible[i]];
+        scene->drawKeys[i] = DrawKey{MakeDrawKey(node), (uint32_t) node->sceneIndex, node};
+    }
+    SortSceneDrawable(scene);
+    // camera bounding rect is drawn last, on top of the scene
+    scene->drawable.push_back((Node2D*) scene->activeCamera);
+}
+
+
+// Behaviors run first in one forward sweep on this thread, then the
+// physics owners are interpolated and the subtrees of the nodes that were
+// set are propagated span by span on the workers. Nothing here walks the
+// whole hierarchy unless it changed, a static level costs what moves.
+void SceneGraph::UpdatePass(Scene *scene, unsigned int fps, double deltaTime) {
+    scene->frame++;
+    scene->transformsUpdated = 0;
+    RefreshStructure(scene);
+    for(uint32_t u = 0; u < scene->updatables.size(); ) {
+        Node2D* current = scene->updatables[u];
+        uint32_t index = (uint32_t) current->sceneIndex;
+        current->behavior.Update(current, fps, deltaTime);
+        u = NextUpdatable(scene, current, index, u);
+    }
+    // drawn physics pose, propagated to children and bounds like any other move
+    CorePhysics::InterpolatePass();
+
+    UpdateCameraBounds(scene);
+    GatherDirtyRanges(scene);
+    // heads are parents of later spans, they go first and in order
+    for(uint32_t s : scene->activeSpans) {
+        if(scene->spans[s].head) UpdateSpanNodes(scene, scene->spans[s]);
+    }
+    CoreJobs::ParallelFor((uint32_t) scene->activeSpans.size(), 1, UpdateSpanBatch, scene);
+    UpdateCameraViews(scene);
+    UpdateSpatialIndex(scene);
+    CullPass(scene);
 }
 
 
 // TODO: Shutdown pass should be called whenever scene changes or engine shutdown
 void SceneGraph::ShutdownPass(Scene *scene) {
-    Node2D* root = scene->sceneRoot;
-    std::stack<Node2D *> stack;
-    std::set<Node2D *> visited;
-    stack.push(root);
-    while(!stack.empty()){
-        Node2D* current = stack.top();
-        stack.pop();
-        auto it = visited.find(current);
-        if(it == visited.end()){
-            if(current->behavior.Shutdown) {
-                current->behavior.Shutdown(current);
-            }
-            visited.insert(current);
-            for(auto it = current->children.begin(); it != current->children.end(); ++it){
-                Node2D* child = (Node2D*) *it;
-                stack.push(child);
-            }
+    std::vector<Node2D*> &nodes = scene->hierarchy.nodes;
+    for(uint32_t i = 0; i < nodes.size(); ) {
+        Node2D* current = nodes[i];
+        if(current->behavior.Shutdown) {
+            current->behavior.Shutdown(current);
         }
+        i = NextIndex(current, i);
     }
 }
 
 
+uint32_t SceneGraph::GetUpdatedTransformCount(Scene *scene) {
+    return scene->transformsUpdated;
+}
+
+
 void SceneGraph::DrawPass(Scene *scene) {
     for(Node2D* node : scene->drawable) {
         switch(node->type){
@@ -299,48 +693,50 @@ void SceneGraph::DrawPass(Scene *scene) {
 }
 
 
-void SceneGraph::SortSceneDrawable(std::vector<Node2D*> &drawable) {
-    if(drawable.size() <= 1) return;
-    if(drawable.size() == 2) {
-        if(drawable[0]->zIndex >= drawable[1]->zIndex) {
-            Node2D *tmp = drawable[0];
-            drawable[0] = drawable[1];
-            drawable[1] = tmp;
-        }
-        return;
-    }
-    int middle = std::floor(drawable.size() / 2);
-    std::vector<Node2D*> left = std::vector<Node2D*>(drawable.begin(), drawable.begin() + middle);
-    std::vector<Node2D*> right = std::vector<Node2D*>(drawable.begin() + middle, drawable.end());
-
-    SortSceneDrawable(left);
-    SortSceneDrawable(right);
-
-    int i, j, k;
-    i = j  = k = 0;
-    int n = left.size();
-    int m = right.size();
-    while ((i < n) && ((j < m))) {
-        if(left[i]->zIndex >= right[j]->zIndex) {
-            drawable[k] = right[j];
-            j++;
-        }else{
-            drawable[k] = left[i];
-            i++;
+const uint32_t SORT_PASSES = 12; // 4 order bytes then 8 key bytes
+
+
+static inline uint32_t SortDigit(const DrawKey &k, uint32_t pass) {
+    return pass < 4
+        ? (k.order >> (pass * 8)) & 0xFF
+        : (uint32_t) (k.key >> ((pass - 4) * 8)) & 0xFF;
+}
+
+
+// Stable LSD radix sort, one byte per pass, hierarchy order first then the
+// key. Bytes equal across all keys are skipped, so unused layers and
+// resource bits cost no pass.
+void SceneGraph::SortSceneDrawable(Scene *scene) {
+    std::vector<DrawKey> &keys = scene->drawKeys;
+    std::vector<DrawKey> &scratch = scene->sortScratch;
+    uint32_t n = (uint32_t) keys.size();
+    scratch.resize(n);
+
+    uint32_t counts[SORT_PASSES][256] = {};
+    for(const DrawKey &k : keys) {
+        for(uint32_t pass = 0; pass < SORT_PASSES; pass++) {
+            counts[pass][SortDigit(k, pass)]++;
         }
-        k++;
     }
 
-    while(i < n) {
-        drawable[k] = left[i];
-        i++;
-        k++;
+    DrawKey *from = keys.data();
+    DrawKey *to = scratch.data();
+    for(uint32_t pass = 0; pass < SORT_PASSES && n > 1; pass++) {
+        uint32_t *count = counts[pass];
+        if(count[SortDigit(from[0], pass)] == n) continue;
+        uint32_t offset = 0;
+        for(uint32_t d = 0; d < 256; d++) {
+            uint32_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for(uint32_t i = 0; i < n; i++) {
+            to[count[SortDigit(from[i], pass)]++] = from[i];
+        }
+        std::swap(from, to);
     }
 
-    while(j < n) {
-        drawable[k] = right[j];
-        j++;
-        k++;
+    for(uint32_t i = 0; i < n; i++) {
+        scene->drawable.push_back(from[i].node);
     }
 }
-
@@ -0,0 +1,53 @@
+#include <platform/FontLoader.h>
+
+/*
+ * Header:  FontLoader.h
+ * Impl:    FontLoader_null.cpp
+ * Purpose: Headless backend next to Graphics_null.cpp, fonts have no
+ *          atlas and text renders to an empty surface.
+ * Author:  Michael Herman
+ * */
+
+
+bool FontLoader::Initialize() {
+    return true;
+}
+
+
+bool FontLoader::Shutdown() {
+    return true;
+}
+
+
+FontLoader::Font* FontLoader::LoadFont(const char* path, uint32_t size) {
+    Font *font = new Font();
+    font->family = path;
+    font->size = size;
+    font->atlas = nullptr;
+    return font;
+}
+
+
+bool FontLoader::RenderText(RGBA** surfaceBuffer, Font* font, const char* text, uint32_t &width, uint32_t &height) {
+    *surfaceBuffer = nullptr;
+    width = 0;
+    height = 0;
+    return true;
+}
+
+
+bool FontLoader::RenderTextBox(RGBA** surfaceBuffer, Font* font, const char* text, uint32_t boxW, uint32_t boxH) {
+    *surfaceBuffer = nullptr;
+    return true;
+}
+
+
+// the font itself is not deleted, same as FontLoader_win.cpp
+bool FontLoader::FreeFont(Font *font) {
+    return true;
+}
+
+
+void FontLoader::DrawGlyph(Glyph glyph, uint8_t* glyphBuffer, uint32_t targetWidth, uint32_t targetHeight) {}
+void FontLoader::SaveToBuffer(unsigned char* inBuffer, RGBA* outBuffer, uint32_t w, uint32_t h) {}
+void FontLoader::PrintGlyphBuffer(RGBA* buffer, uint32_t w, uint32_t h) {}
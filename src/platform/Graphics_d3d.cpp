@@ -1173,7 +1173,7 @@ void Graphics::Draw(GameObject::Sprite *sprite) {
     ShaderD3D *shader = static_cast<ShaderD3D*>(sprite->material->shader->resource.buffer);
 
     // Update global constants
-    localConstants.world = DirectX::XMMATRIX(sprite->transform.World.f); 
+    localConstants.world = DirectX::XMMATRIX(CoreMath::ToMatrix(sprite->transform.World).f); 
     UpdateConstantBuffers(g_lcBuffer, &localConstants, sizeof(localConstants));
 
     // Update local constants
@@ -1236,7 +1236,7 @@ void Graphics::Draw(GameObject::AnimatedSprite *animatedSprite) {
     }
 
     // Update global constants
-    localConstants.world = DirectX::XMMATRIX(animatedSprite->sprite.transform.World.f); 
+    localConstants.world = DirectX::XMMATRIX(CoreMath::ToMatrix(animatedSprite->sprite.transform.World).f); 
     UpdateConstantBuffers(g_lcBuffer, &localConstants, sizeof(localConstants));
 
     // Update local constants
@@ -1264,7 +1264,7 @@ void Graphics::Draw(GameObject::Text *text) {
     TextureD3D *tex = static_cast<TextureD3D*>(text->textureResource.buffer);
     ID3D11Buffer *cb = (ID3D11Buffer*) text->constantBuffers.buffer;
 
-    localConstants.world = DirectX::XMMATRIX(text->transform.World.f);
+    localConstants.world = DirectX::XMMATRIX(CoreMath::ToMatrix(text->transform.World).f);
     UpdateConstantBuffers(g_lcBuffer, &localConstants, sizeof(localConstants));
     
     UINT strides = sizeof(Vertex);
@@ -0,0 +1,64 @@
+#include <platform/Graphics.h>
+
+/*
+ * Header:  Graphics.h
+ * Impl:    Graphics_null.cpp
+ * Purpose: Headless backend, resources are accepted and draws are dropped.
+ *          Lets the engine core run without a window (EngineBench).
+ * Author:  Michael Herman
+ * */
+
+
+// Size reported in place of a window, cameras are sized after it
+static const float SCREEN_WIDTH = 1280.0f;
+static const float SCREEN_HEIGHT = 720.0f;
+
+
+bool Graphics::CreateShader(GameResource::Shader *shader) { return true; }
+bool Graphics::RemoveShader(GameResource::Shader *shader) { return true; }
+
+bool Graphics::CreateTexture(GameResource::Texture *texture) { return true; }
+bool Graphics::RemoveTexture(GameResource::Texture *texture) { return true; }
+
+bool Graphics::CreateMaterial(GameResource::Material *material) { return true; }
+bool Graphics::RemoveMaterial(GameResource::Material *material) { return true; }
+
+bool Graphics::CreateGeometry(GameObject::Sprite *sprite) { return true; }
+bool Graphics::RemoveGeometry(GameObject::Sprite *sprite) { return true; }
+
+bool Graphics::CreateGeometry(GameObject::Text *text) { return true; }
+bool Graphics::RemoveGeometry(GameObject::Text *text) { return true; }
+
+bool Graphics::CreateGeometry(DebugDraw::Text *text) { return true; }
+bool Graphics::RemoveGeometry(DebugDraw::Text *text) { return true; }
+
+void Graphics::Draw(GameObject::Sprite *sprite) {}
+void Graphics::Draw(GameObject::AnimatedSprite *animatedSprite) {}
+void Graphics::Draw(GameObject::Text *text) {}
+void Graphics::Draw(GameObject::Camera *camera) {}
+void Graphics::Draw(CoreGeometry::BoundingRect &aabb) {}
+
+void Graphics::Draw(DebugDraw::Text *text) {}
+
+
+bool Graphics::UpdateMaterialParameters(GameResource::Material **material) {
+    return true;
+}
+
+
+Vector2 Graphics::GetScreenDimension() {
+    return CoreMath::CreateVector2(SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+
+void Graphics::UpdateViewProjectionMatrix(GameObject::Camera *camera) {}
+
+
+bool Graphics::UpdateTexture(GraphicsResource &textureResource, GraphicsResource &vertexResource, void *data, uint32_t width, uint32_t height) {
+    return true;
+}
+
+
+bool Graphics::UpdateStaticTexture(GraphicsResource &textureResource, void *data, uint32_t boxW, uint32_t boxH) {
+    return true;
+}